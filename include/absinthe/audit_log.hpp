@@ -0,0 +1,148 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absinthe/chat_message.hpp"
+
+namespace absinthe
+{
+    // On-disk layout, all integers little endian:
+    //   file header: "ABSAUDT1"
+    //   record:      kRecordSize bytes: u64 time (unix ms), 16 byte UUID,
+    //                u8 source, u8 result, u8 signature, u8 player length,
+    //                u16 command length, u16 reserved, player (16 bytes),
+    //                command (truncated), zero padding, u32 CRC-32 of all
+    //                preceding bytes of the record
+    // Records have a fixed size, so the newest ones can be read from the end
+    // of the file without scanning it, and a torn or corrupt record is
+    // detected by its checksum alone.
+    namespace audit
+    {
+        constexpr char kFileMagic[8] = { 'A', 'B', 'S', 'A', 'U', 'D', 'T', '1' };
+        constexpr std::size_t kRecordSize = 256;
+        constexpr std::size_t kMaxPlayerLength = 16;
+        constexpr std::size_t kMaxCommandLength = kRecordSize - 48 - 4;
+
+        enum class Source : std::uint8_t
+        {
+            Chat = 0,
+            Console = 1,
+            Control = 2
+        };
+
+        enum class Result : std::uint8_t
+        {
+            Ok = 0,
+            Denied = 1,
+            Failed = 2,
+            Cancelled = 3
+        };
+
+        enum class Signature : std::uint8_t
+        {
+            None = 0,
+            Missing = 1,
+            Unchecked = 2,
+            Verified = 3,
+            Invalid = 4
+        };
+
+        struct Entry
+        {
+            std::int64_t time_ms = 0;
+            ProtocolCraft::UUID sender{};
+            std::string player;
+            Source source = Source::Chat;
+            Result result = Result::Ok;
+            Signature signature = Signature::None;
+            std::string command;
+        };
+
+        struct QueryResult
+        {
+            std::vector<Entry> entries;
+            std::string error;
+        };
+
+        const char* GetName(Source source);
+        const char* GetName(Result result);
+        const char* GetName(Signature signature);
+
+        // Encode leaves the checksum zero; Seal fills it in once the record
+        // is final. Decode rejects a record whose checksum or lengths are off.
+        void Encode(const Entry& entry, unsigned char* out);
+        void Seal(unsigned char* record);
+        bool Decode(const unsigned char* data, Entry& entry);
+        // Whole records in a file of file_size bytes, ignoring a torn tail.
+        std::size_t CountRecords(std::size_t file_size);
+    }
+
+    // Append-only audit trail. Append encodes the record straight into a
+    // bounded lock-free ring, so the chat thread never takes a lock or waits
+    // on disk; a background thread checksums and writes whatever is queued
+    // in one batch and fsyncs the file periodically.
+    class AuditLog
+    {
+    public:
+        explicit AuditLog(std::size_t capacity = 4096);
+        ~AuditLog();
+
+        AuditLog(const AuditLog&) = delete;
+        AuditLog& operator=(const AuditLog&) = delete;
+
+        bool Open(const std::string& path, std::string* error = nullptr);
+        void Close();
+        // Stamps the current time. Returns false when the log is closed or the
+        // ring is full and the record was dropped.
+        bool Append(audit::Entry entry);
+
+        // Newest first, reading backwards from the end of the file. player,
+        // when given, is a case insensitive name or a dashed UUID. The scan
+        // runs on the audit thread once it has written everything appended
+        // before this call, so records still queued in the ring are included.
+        std::future<audit::QueryResult> QueryRecent(std::string player, std::size_t limit);
+
+    private:
+        struct Slot
+        {
+            std::atomic<std::size_t> sequence{ 0 };
+            std::array<unsigned char, audit::kRecordSize> bytes{};
+        };
+
+        struct Query
+        {
+            std::string player;
+            std::size_t limit = 0;
+            std::promise<audit::QueryResult> result;
+        };
+
+        void Run();
+        void Drain(std::vector<unsigned char>& batch);
+        bool WriteAll(const std::vector<unsigned char>& batch);
+        void Answer(std::deque<Query>& queries) const;
+        std::vector<audit::Entry> ReadRecent(const std::string& player, std::size_t limit, std::string* error) const;
+
+        std::unique_ptr<Slot[]> slots_;
+        std::size_t mask_ = 0;
+        std::atomic<std::size_t> tail_{ 0 };
+        std::size_t head_ = 0;
+
+        int fd_ = -1;
+        std::thread thread_;
+        std::mutex wake_mutex_;
+        std::condition_variable wake_;
+        std::deque<Query> queries_;
+        std::atomic<bool> stopping_{ false };
+    };
+}
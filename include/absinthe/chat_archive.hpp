@@ -0,0 +1,129 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absinthe/chat_client.hpp"
+
+namespace absinthe
+{
+    // On-disk layout, all integers little endian:
+    //   file header: "ABSARCH1"
+    //   block:       BlockHeader, sender index, payload
+    //   index:       u16 count, then per sender 16 byte UUID, u8 length, name
+    //   payload:     records of u64 time (unix ms), u16 sender, u8 flags,
+    //                u16 length, content; zlib-compressed when codec is 1
+    // The header and index of every block are stored uncompressed, so a reader
+    // can skip blocks by time range or sender without inflating them.
+    namespace archive
+    {
+        constexpr char kFileMagic[8] = { 'A', 'B', 'S', 'A', 'R', 'C', 'H', '1' };
+        constexpr std::uint32_t kBlockMagic = 0x4B4C4241; // "ABLK"
+        constexpr std::size_t kBlockHeaderSize = 40;
+
+        enum class Codec : std::uint8_t
+        {
+            Stored = 0,
+            Zlib = 1
+        };
+
+        enum RecordFlags : std::uint8_t
+        {
+            kHasSignature = 1,
+            kSecureChatEnforced = 2
+        };
+
+        struct BlockHeader
+        {
+            Codec codec = Codec::Stored;
+            std::uint32_t record_count = 0;
+            std::uint32_t raw_size = 0;
+            std::uint32_t stored_size = 0;
+            std::uint32_t index_size = 0;
+            std::int64_t first_ms = 0;
+            std::int64_t last_ms = 0;
+        };
+
+        struct Record
+        {
+            std::int64_t time_ms = 0;
+            ProtocolCraft::UUID sender{};
+            std::string sender_name;
+            std::string content;
+            std::uint8_t flags = 0;
+        };
+
+        bool IsCodecSupported(Codec codec);
+    }
+
+    // Append-only chat sink. Append only moves the message into a pending
+    // vector under a short lock; a background thread cuts blocks, compresses
+    // them and writes them out, so the network thread never waits on disk.
+    class ChatArchive
+    {
+    public:
+        ChatArchive() = default;
+        ~ChatArchive();
+
+        ChatArchive(const ChatArchive&) = delete;
+        ChatArchive& operator=(const ChatArchive&) = delete;
+
+        bool Open(const std::string& path, std::string* error = nullptr);
+        void Close();
+        void Append(const ChatMessage& message);
+
+    private:
+        void Run();
+        void WriteBlock(const std::vector<archive::Record>& records);
+
+        std::FILE* file_ = nullptr;
+        std::thread thread_;
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        std::vector<archive::Record> pending_;
+        std::size_t pending_bytes_ = 0;
+        bool stopping_ = false;
+    };
+
+    class ChatArchiveReader
+    {
+    public:
+        struct Query
+        {
+            std::int64_t from_ms = std::numeric_limits<std::int64_t>::min();
+            std::int64_t to_ms = std::numeric_limits<std::int64_t>::max();
+            // Player name (case insensitive) or dashed UUID, empty for everyone.
+            std::string sender;
+        };
+
+        struct Stats
+        {
+            std::size_t blocks = 0;
+            std::size_t blocks_decoded = 0;
+            std::size_t records = 0;
+            std::size_t matches = 0;
+        };
+
+        ChatArchiveReader() = default;
+        ~ChatArchiveReader();
+
+        ChatArchiveReader(const ChatArchiveReader&) = delete;
+        ChatArchiveReader& operator=(const ChatArchiveReader&) = delete;
+
+        bool Open(const std::string& path, std::string* error = nullptr);
+        bool Scan(const Query& query, const std::function<void(const archive::Record&)>& callback,
+            Stats* stats = nullptr, std::string* error = nullptr) const;
+
+    private:
+        const unsigned char* data_ = nullptr;
+        std::size_t size_ = 0;
+    };
+}
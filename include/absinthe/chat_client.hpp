@@ -4,38 +4,97 @@
 #include <mutex>
 #include <string>
 
+#include "absinthe/chat_message.hpp"
 #include "botcraft/AI/TemplatedBehaviourClient.hpp"
 #include "protocolCraft/BinaryReadWrite.hpp"
 
 namespace absinthe
 {
-    struct ChatMessage
+    class ChatInbox
     {
-        ProtocolCraft::UUID sender{};
-        std::string sender_name;
-        std::string content;
-        bool has_signature = false;
+    public:
+        void PushMessage(ChatMessage message);
+        bool PopMessage(ChatMessage& message);
+
+    private:
+        std::mutex mutex;
+        std::deque<ChatMessage> messages;
+    };
+
+    class ChatEndpoint
+    {
+    public:
+        virtual ~ChatEndpoint() = default;
+
+        virtual bool PopChatMessage(ChatMessage& message) = 0;
+        virtual void SendChat(const std::string& text) = 0;
+        virtual bool IsConnected() const = 0;
+        // Ends the connection loop; safe to call from any thread.
+        virtual void Close() = 0;
+    };
+
+#if PROTOCOL_VERSION > 758 /* > 1.18.2 */
+    bool ReadPlayerChat(ProtocolCraft::ClientboundPlayerChatPacket& packet, ChatMessage& message);
+#endif
+
+    class ChatArchive;
+    class ChatSignatureVerifier;
+
+    // Chat handling shared by both clients, which only differ in where the
+    // base packet handling and player names come from. Packet callbacks run
+    // on the network thread.
+    class ChatPacketHandler
+    {
+    public:
+        bool PopChatMessage(ChatMessage& message);
+        bool IsSecureChatEnforced() const;
+        void SetSignatureVerifier(ChatSignatureVerifier* verifier);
+        void SetArchive(ChatArchive* sink);
+
+        void OnLogin(ProtocolCraft::ClientboundLoginPacket& packet);
+#if PROTOCOL_VERSION > 760 /* > 1.19.2 */
+        void OnPlayerInfoUpdate(ProtocolCraft::ClientboundPlayerInfoUpdatePacket& packet);
+        void OnPlayerInfoRemove(ProtocolCraft::ClientboundPlayerInfoRemovePacket& packet);
+#endif
+#if PROTOCOL_VERSION > 758 /* > 1.18.2 */
+        // Returns false when the packet carries no readable text. The caller
+        // fills in the sender's name before handing the message to Deliver.
+        bool Decode(ProtocolCraft::ClientboundPlayerChatPacket& packet, ChatMessage& message) const;
+        void Deliver(ProtocolCraft::ClientboundPlayerChatPacket& packet, ChatMessage message, bool readable);
+#endif
+
+    private:
+        ChatInbox inbox;
+        ChatSignatureVerifier* signature_verifier = nullptr;
+        ChatArchive* archive = nullptr;
         bool secure_chat_enforced = false;
     };
 
-    class ChatBehaviourClient : public Botcraft::TemplatedBehaviourClient<ChatBehaviourClient>
+    class ChatBehaviourClient : public Botcraft::TemplatedBehaviourClient<ChatBehaviourClient>, public ChatEndpoint
     {
     public:
         explicit ChatBehaviourClient(bool use_renderer);
 
-        bool PopChatMessage(ChatMessage& message);
+        bool PopChatMessage(ChatMessage& message) override;
+        void SendChat(const std::string& text) override;
+        bool IsConnected() const override;
+        void Close() override;
         bool IsSecureChatEnforced() const;
+        void SetSignatureVerifier(ChatSignatureVerifier* verifier);
+        void SetArchive(ChatArchive* sink);
 
     protected:
         using Botcraft::TemplatedBehaviourClient<ChatBehaviourClient>::Handle;
         void Handle(ProtocolCraft::ClientboundLoginPacket& packet) override;
+#if PROTOCOL_VERSION > 760 /* > 1.19.2 */
+        void Handle(ProtocolCraft::ClientboundPlayerInfoUpdatePacket& packet) override;
+        void Handle(ProtocolCraft::ClientboundPlayerInfoRemovePacket& packet) override;
+#endif
 #if PROTOCOL_VERSION > 758 /* > 1.18.2 */
         void Handle(ProtocolCraft::ClientboundPlayerChatPacket& packet) override;
 #endif
 
     private:
-        mutable std::mutex chat_mutex;
-        std::deque<ChatMessage> chat_messages;
-        bool secure_chat_enforced = false;
+        ChatPacketHandler chat;
     };
 }
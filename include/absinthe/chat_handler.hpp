@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <optional>
 #include <string>
 #include <vector>
@@ -10,6 +12,8 @@ namespace absinthe
     {
         std::string name;
         std::vector<std::string> args;
+        // Permission bit from the command resolver, empty for unknown commands.
+        std::optional<std::size_t> id;
     };
 
     struct ChatParseResult
@@ -18,19 +22,30 @@ namespace absinthe
         bool ok = false;
         std::string error;
         ChatCommand command;
+        std::vector<ChatCommand> batch;
     };
 
     class ChatHandler
     {
     public:
+        // Vanilla servers disconnect clients that send longer chat messages.
+        static constexpr std::size_t kMaxChatLength = 256;
+
+        using CommandResolver = std::function<std::optional<std::size_t>(const std::string&)>;
+
         explicit ChatHandler(std::string prefix = "?");
 
         const std::string& GetPrefix() const;
+        // Parse stamps each command with its id, so permission checks are a
+        // bit test.
+        void SetCommandResolver(CommandResolver resolver);
         ChatParseResult Parse(const std::string& message) const;
-        std::optional<std::string> HandleCommand(const ChatCommand& command) const;
-        std::string FormatHelp() const;
+        // One chat message per element, each at most kMaxChatLength bytes.
+        std::vector<std::string> HandleCommand(const ChatCommand& command) const;
+        std::vector<std::string> FormatHelp() const;
 
     private:
         std::string prefix_;
+        CommandResolver resolver_;
     };
 }
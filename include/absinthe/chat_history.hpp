@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "absinthe/chat_message.hpp"
+
+namespace absinthe
+{
+    // Fixed-size ring of recent chat lines. Content is packed into a circular
+    // byte arena and senders are interned, so memory is bounded by the
+    // configured message count and arena size. A token -> message inverted
+    // index is kept in step with the ring: every posting list is ordered by
+    // sequence number, so evicting the oldest message only pops the front of
+    // the lists for its own tokens.
+    class ChatHistory
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Entry
+        {
+            std::string sender_name;
+            std::string content;
+            Clock::time_point received;
+        };
+
+        ChatHistory(std::size_t max_messages, std::size_t arena_bytes);
+
+        void Record(const ChatMessage& message);
+
+        // Newest first. Every term must appear in the message; player, when
+        // given, restricts matches to that sender.
+        std::vector<Entry> Search(const std::vector<std::string>& terms, const std::string& player, std::size_t limit) const;
+        std::optional<Entry> Last(const std::string& player) const;
+        bool HasSender(const std::string& player) const;
+
+        std::size_t GetSize() const;
+
+    private:
+        // Sequence numbers of live messages in ascending order. Popped from the
+        // front on eviction and compacted once the dead prefix dominates.
+        struct Postings
+        {
+            std::vector<std::uint64_t> sequences;
+            std::size_t head = 0;
+
+            bool IsEmpty() const { return head == sequences.size(); }
+            std::size_t GetSize() const { return sequences.size() - head; }
+            void PopFront();
+            bool Contains(std::uint64_t sequence) const;
+        };
+
+        struct Slot
+        {
+            std::uint32_t offset = 0;
+            std::uint32_t length = 0;
+            std::uint32_t sender = 0;
+            Clock::time_point received;
+        };
+
+        struct Sender
+        {
+            std::string name;
+            Postings messages;
+        };
+
+        static void Tokenize(std::string_view text, std::vector<std::string>& tokens);
+
+        std::uint32_t Allocate(std::uint32_t length);
+        void EvictOldest();
+        std::uint32_t InternSender(const std::string& name);
+        const Sender* FindSender(const std::string& player) const;
+        Entry MakeEntry(std::uint64_t sequence) const;
+        const Slot& GetSlot(std::uint64_t sequence) const;
+
+        std::vector<Slot> slots_;
+        std::vector<char> arena_;
+        std::uint32_t arena_tail_ = 0;
+        std::uint64_t first_sequence_ = 0;
+        std::uint64_t next_sequence_ = 0;
+
+        std::vector<Sender> senders_;
+        std::vector<std::uint32_t> free_senders_;
+        std::unordered_map<std::string, std::uint32_t> sender_ids_;
+        std::unordered_map<std::string, Postings> index_;
+        std::vector<std::string> tokens_;
+    };
+}
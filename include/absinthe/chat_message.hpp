@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "protocolCraft/BinaryReadWrite.hpp"
+
+namespace absinthe
+{
+    struct ChatMessage
+    {
+        ProtocolCraft::UUID sender{};
+        std::string sender_name;
+        std::string content;
+        bool has_signature = false;
+        bool signature_verified = false;
+        bool secure_chat_enforced = false;
+        std::uint64_t received_ns = 0;
+    };
+}
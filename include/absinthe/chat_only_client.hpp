@@ -0,0 +1,46 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "absinthe/chat_client.hpp"
+#include "botcraft/Game/ConnectionClient.hpp"
+
+namespace absinthe
+{
+    // Connection-level client for --chat-only. Unlike ChatBehaviourClient it
+    // never creates the world, entity, inventory or physics managers, so
+    // chunk, light and entity packets are dropped as soon as they are read
+    // instead of being decoded into game state.
+    class ChatOnlyClient : public Botcraft::ConnectionClient, public ChatEndpoint
+    {
+    public:
+        ChatOnlyClient();
+
+        bool PopChatMessage(ChatMessage& message) override;
+        void SendChat(const std::string& text) override;
+        bool IsConnected() const override;
+        void Close() override;
+        bool IsSecureChatEnforced() const;
+        std::string GetPlayerName(const ProtocolCraft::UUID& uuid) const;
+        void SetSignatureVerifier(ChatSignatureVerifier* verifier);
+        void SetArchive(ChatArchive* sink);
+
+    protected:
+        using Botcraft::ConnectionClient::Handle;
+        void Handle(ProtocolCraft::ClientboundLoginPacket& packet) override;
+#if PROTOCOL_VERSION > 760 /* > 1.19.2 */
+        void Handle(ProtocolCraft::ClientboundPlayerInfoUpdatePacket& packet) override;
+        void Handle(ProtocolCraft::ClientboundPlayerInfoRemovePacket& packet) override;
+#endif
+#if PROTOCOL_VERSION > 758 /* > 1.18.2 */
+        void Handle(ProtocolCraft::ClientboundPlayerChatPacket& packet) override;
+#endif
+
+    private:
+        ChatPacketHandler chat;
+        mutable std::mutex names_mutex;
+        std::map<ProtocolCraft::UUID, std::string> player_names;
+    };
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace absinthe
+{
+    enum class TriggerAction
+    {
+        Alert,
+        Reply
+    };
+
+    struct ChatTrigger
+    {
+        std::string pattern;
+        TriggerAction action = TriggerAction::Alert;
+        std::string reply;
+        std::chrono::seconds cooldown{ 10 };
+    };
+
+    // Aho-Corasick automaton over every configured pattern. Input bytes are
+    // case folded and mapped to a small set of byte classes, and the goto
+    // function is completed into a flat state x class table, so a scan is one
+    // table load per byte regardless of the number of patterns.
+    class TriggerAutomaton
+    {
+    public:
+        explicit TriggerAutomaton(const std::vector<ChatTrigger>& triggers);
+
+        // Appends the index of every trigger found in text, once each, in
+        // ascending order.
+        void Scan(std::string_view text, std::vector<std::uint32_t>& matches) const;
+        std::size_t GetStateCount() const;
+        std::size_t GetMemoryUsage() const;
+
+    private:
+        static constexpr std::uint32_t kNoState = 0xFFFFFFFFu;
+
+        std::uint32_t AddState();
+
+        std::array<std::uint8_t, 256> byte_classes_{};
+        std::uint32_t class_count_ = 1;
+        std::vector<std::uint32_t> transitions_;
+        std::vector<std::uint32_t> output_begin_;
+        std::vector<std::uint32_t> outputs_;
+        std::vector<std::uint32_t> dictionary_links_;
+    };
+
+    // Loading parses and compiles a complete new set that is only staged, so
+    // it can run off the chat thread; Commit swaps it in at a tick boundary,
+    // the same way plugin reloads go live.
+    class ChatTriggers
+    {
+    public:
+        struct Hit
+        {
+            const ChatTrigger* trigger = nullptr;
+            bool cooling_down = false;
+        };
+
+        // Safe to call from any thread. Nothing is staged if the file is bad.
+        bool LoadFromFile(const std::string& path, std::string* error = nullptr);
+        // Returns true if a staged set replaced the active one.
+        bool Commit();
+        bool HasStaged() const;
+        bool IsEmpty() const;
+        std::size_t GetCount() const;
+        std::string Describe() const;
+
+        std::vector<Hit> Match(std::string_view text);
+
+    private:
+        struct Compiled
+        {
+            std::vector<ChatTrigger> triggers;
+            std::shared_ptr<const TriggerAutomaton> automaton;
+        };
+
+        mutable std::mutex staged_mutex;
+        std::unique_ptr<Compiled> staged;
+
+        std::vector<ChatTrigger> triggers;
+        std::shared_ptr<const TriggerAutomaton> automaton;
+        std::vector<std::chrono::steady_clock::time_point> last_fired;
+        std::vector<std::uint32_t> scratch;
+    };
+}
@@ -1,30 +1,96 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <map>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-#include "absinthe/chat_client.hpp"
+#include "absinthe/chat_message.hpp"
 
 namespace absinthe
 {
+    // Allowlist entries carry roles, and each role grants a set of commands.
+    // Roles compile into one permission bitmask per entry, indexed by command
+    // id. The first message from a UUID merges its UUID and name entries into
+    // a single uuid -> mask table, so authorizing a command afterwards is one
+    // hash lookup on the sender plus a bit test on the id the chat handler
+    // resolved while parsing. Entry changes start that table over.
     class ChatWhitelist
     {
     public:
-        bool AddEntry(const std::string& entry);
-        bool RemoveEntry(const std::string& entry);
+        static constexpr const char* kDefaultRole = "admin";
+
+        ChatWhitelist();
+
+        bool AddEntry(const std::string& entry, const std::string& role = kDefaultRole);
+        // Drops one role from the entry, or the whole entry when role is empty
+        // or was its last one.
+        bool RemoveEntry(const std::string& entry, const std::string& role = "");
         bool IsEmpty() const;
         bool LoadFromFile(const std::string& path, std::string* error = nullptr);
         bool SaveToFile(const std::string& path, std::string* error = nullptr) const;
-        bool IsAllowed(const ChatMessage& message) const;
         std::string FormatEntries() const;
 
+        static bool IsBuiltinCommand(const std::string& name);
+        bool HasRole(const std::string& role) const;
+        std::optional<std::size_t> FindCommand(const std::string& name) const;
+        // Registers a command name not known at build time, returning its id,
+        // or nothing once all kMaxCommands slots are taken.
+        std::optional<std::size_t> RegisterCommand(const std::string& name);
+        // Frees the slot of a command that is gone, e.g. an unloaded plugin's.
+        // Built-ins and commands a role names keep theirs.
+        bool UnregisterCommand(const std::string& name);
+
+        // Union of the sender's UUID and name entries, zero when the sender is
+        // not on the allowlist at all. A name entry binds to the first UUID
+        // seen with that name until the allowlist next changes.
+        std::uint64_t GetPermissions(const ChatMessage& message);
+        // command_id is empty for a command that has no permission bit, which
+        // is always denied.
+        static bool Permits(std::uint64_t permissions, const std::optional<std::size_t>& command_id);
+
     private:
+        static constexpr std::size_t kMaxCommands = 64;
+        static constexpr std::size_t kMaxSenders = 4096;
+
+        struct Role
+        {
+            std::vector<std::string> commands;
+            std::uint64_t mask = 0;
+        };
+
+        struct Entry
+        {
+            std::string key;
+            std::optional<ProtocolCraft::UUID> uuid;
+            std::vector<std::string> roles;
+        };
+
+        struct UuidHash
+        {
+            std::size_t operator()(const ProtocolCraft::UUID& uuid) const;
+        };
+
         static std::optional<ProtocolCraft::UUID> ParseUuid(const std::string& value);
         static std::string NormalizeName(const std::string& value);
         static std::string FormatUuid(const ProtocolCraft::UUID& uuid);
+        static std::map<std::string, Role> DefaultRoles();
+
+        std::vector<Entry>::iterator FindEntry(const std::string& entry);
+        std::uint64_t CompileRole(const Role& role) const;
+        void UpdateMask(const Entry& entry);
+        void RebuildMasks();
 
-        std::vector<ProtocolCraft::UUID> allowed_uuids;
-        std::vector<std::string> allowed_names;
+        std::vector<Entry> entries;
+        std::map<std::string, Role> roles;
+        std::vector<std::string> command_names;
+        std::unordered_map<std::string, std::size_t> command_ids;
+        std::unordered_map<ProtocolCraft::UUID, std::uint64_t, UuidHash> uuid_masks;
+        std::unordered_map<std::string, std::uint64_t> name_masks;
+        // Every sender seen since the last change, including unlisted ones.
+        std::unordered_map<ProtocolCraft::UUID, std::uint64_t, UuidHash> sender_masks;
     };
 }
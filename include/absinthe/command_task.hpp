@@ -0,0 +1,157 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "absinthe/chat_client.hpp"
+
+namespace absinthe
+{
+    // Size-bucketed free lists for coroutine frames. Frames are returned to
+    // the calling thread's pool instead of the heap, so spawning a handler
+    // after warm-up does not allocate.
+    class FramePool
+    {
+    public:
+        static void* Allocate(std::size_t size);
+        static void Deallocate(void* ptr, std::size_t size) noexcept;
+    };
+
+    class CommandTask
+    {
+    public:
+        struct promise_type
+        {
+            CommandTask get_return_object() noexcept;
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+            static void* operator new(std::size_t size) { return FramePool::Allocate(size); }
+            static void operator delete(void* ptr, std::size_t size) noexcept { FramePool::Deallocate(ptr, size); }
+
+            std::exception_ptr exception;
+        };
+
+        using Handle = std::coroutine_handle<promise_type>;
+
+        CommandTask(CommandTask&& other) noexcept;
+        CommandTask& operator=(CommandTask&& other) noexcept;
+        CommandTask(const CommandTask&) = delete;
+        CommandTask& operator=(const CommandTask&) = delete;
+        ~CommandTask();
+
+        Handle Release() noexcept;
+
+    private:
+        explicit CommandTask(Handle handle);
+
+        Handle handle_;
+    };
+
+    class CommandScheduler
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        enum class WaitKind : std::uint8_t
+        {
+            Tick,
+            Timer,
+            Chat
+        };
+
+        // Lives inside the suspended coroutine frame, so parking a handler
+        // only stores a pointer in one of the scheduler's reserved vectors.
+        struct Waiter
+        {
+            CommandScheduler* scheduler = nullptr;
+            std::coroutine_handle<> handle;
+            WaitKind kind = WaitKind::Tick;
+            Clock::time_point deadline = Clock::time_point::max();
+            ProtocolCraft::UUID sender{};
+            std::string_view reply;
+            std::optional<ChatMessage> message;
+        };
+
+        class TickAwaiter
+        {
+        public:
+            explicit TickAwaiter(CommandScheduler& scheduler);
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle);
+            void await_resume() const noexcept {}
+
+        private:
+            Waiter waiter_;
+        };
+
+        class TimerAwaiter
+        {
+        public:
+            TimerAwaiter(CommandScheduler& scheduler, Clock::duration delay);
+            bool await_ready() const noexcept;
+            void await_suspend(std::coroutine_handle<> handle);
+            void await_resume() const noexcept {}
+
+        private:
+            Waiter waiter_;
+        };
+
+        class ChatAwaiter
+        {
+        public:
+            ChatAwaiter(CommandScheduler& scheduler, const ProtocolCraft::UUID& sender, std::string_view reply, Clock::duration timeout);
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle);
+            std::optional<ChatMessage> await_resume() noexcept { return std::move(waiter_.message); }
+
+        private:
+            Waiter waiter_;
+        };
+
+        explicit CommandScheduler(std::size_t capacity = 256);
+        ~CommandScheduler();
+
+        CommandScheduler(const CommandScheduler&) = delete;
+        CommandScheduler& operator=(const CommandScheduler&) = delete;
+
+        void Spawn(CommandTask task);
+        // Hands message to the oldest handler waiting for this reply from its
+        // sender. The message is moved from only when this returns true.
+        bool DispatchChat(ChatMessage& message);
+        void Tick();
+        // Destroys every suspended handler without resuming it. Handlers can
+        // tell from IsCancelling() while their frame unwinds.
+        void CancelAll();
+        bool IsCancelling() const { return cancelling_; }
+
+        TickAwaiter NextTick();
+        TimerAwaiter SleepFor(Clock::duration delay);
+        // Resumes with the sender's next message matching reply (ignoring
+        // case and surrounding spaces), or with nullopt after timeout. Other
+        // chat from the sender is dispatched as usual.
+        ChatAwaiter NextChat(const ProtocolCraft::UUID& sender, std::string_view reply, Clock::duration timeout);
+
+    private:
+        void Park(Waiter& waiter);
+        void Unpark(Waiter& waiter);
+        void Resume(std::coroutine_handle<> handle);
+        void ResumeReady();
+
+        std::vector<std::coroutine_handle<>> tasks_;
+        std::vector<Waiter*> tick_waiters_;
+        std::vector<Waiter*> timed_waiters_;
+        std::vector<Waiter*> chat_waiters_;
+        std::vector<std::coroutine_handle<>> ready_;
+        bool resuming_ = false;
+        bool cancelling_ = false;
+    };
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+
+namespace absinthe
+{
+    // One line received on the control socket. Replies produced while the
+    // command runs are collected and sent back as a single JSON response;
+    // anything a suspended command says later is sent as a follow-up event
+    // tagged with the same id.
+    struct ControlRequest
+    {
+        std::uint64_t connection = 0;
+        std::uint64_t id = 0;
+        bool ok = true;
+        bool completed = false;
+        std::vector<std::string> replies;
+    };
+
+    // Non-blocking Unix-domain socket polled from the chat loop. Requests are
+    // newline-terminated command lines; clients may pipeline any number of
+    // them, a bounded number is answered per Poll, and each gets one JSON
+    // line, in order:
+    //   {"id":1,"ok":true,"replies":["..."]}
+    //   {"id":1,"reply":"..."}   (late reply from a suspended command)
+    class ControlSocket
+    {
+    public:
+        using Handler = std::function<void(const std::shared_ptr<ControlRequest>&, const std::string&)>;
+
+        ControlSocket() = default;
+        ~ControlSocket();
+
+        ControlSocket(const ControlSocket&) = delete;
+        ControlSocket& operator=(const ControlSocket&) = delete;
+
+        bool Open(const std::string& path, std::string* error = nullptr);
+        void Close();
+
+        // Accepts, reads and answers whatever is ready without waiting.
+        void Poll(const Handler& handler);
+        void Complete(ControlRequest& request);
+        void SendLate(const ControlRequest& request, const std::string& text);
+        std::size_t GetClientCount() const;
+
+    private:
+        struct Connection
+        {
+            int fd = -1;
+            std::uint64_t id = 0;
+            std::uint64_t next_request = 1;
+            std::string input;
+            std::string output;
+            bool eof = false;
+            bool failed = false;
+            bool backlog = false;
+        };
+
+        void Accept();
+        void Read(Connection& connection);
+        void HandleLines(Connection& connection, const Handler& handler, std::size_t& budget);
+        void Flush(Connection& connection);
+        void Queue(std::uint64_t connection_id, const std::string& line);
+
+        int listen_fd_ = -1;
+        std::string path_;
+        std::uint64_t next_connection_ = 1;
+        std::size_t next_reader_ = 0;
+        std::vector<Connection> connections_;
+        std::vector<pollfd> poll_fds_;
+    };
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace absinthe
+{
+    class Metrics
+    {
+    public:
+        static Metrics& GetInstance();
+
+        void Set(const std::string& name, double value);
+        void Add(const std::string& name, double delta);
+        double Get(const std::string& name) const;
+        std::string Format() const;
+
+        // Writes the textfile every interval from a thread of its own, and
+        // once more from StopExport.
+        void StartExport(const std::string& path, std::chrono::milliseconds interval);
+        void StopExport();
+        bool WriteTextfile(const std::string& path, std::string* error = nullptr) const;
+
+    private:
+        Metrics() = default;
+        void ExportLoop();
+        void Export();
+
+        mutable std::mutex mutex;
+        std::map<std::string, double> values;
+
+        std::mutex export_mutex;
+        std::condition_variable export_wake;
+        std::thread export_thread;
+        std::string export_path;
+        std::chrono::milliseconds export_interval{ 5000 };
+        bool export_stopping = false;
+    };
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+/*
+ * C ABI for command plugins. A plugin is a shared object exporting
+ *
+ *     const struct absinthe_plugin* absinthe_plugin_init(void);
+ *
+ * which is called once per load and returns a table that must stay valid
+ * until its shutdown callback (or dlclose) runs. Every load uses a fresh
+ * in-memory copy of the file, so rebuilding a plugin and running "plugins reload"
+ * picks up the new code; the previous copy is closed once no command from
+ * it is still running. Commands run on the chat thread and must not throw.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ABSINTHE_PLUGIN_ABI_VERSION 1u
+#define ABSINTHE_PLUGIN_INIT_SYMBOL "absinthe_plugin_init"
+
+/* Replies are copied before reply returns. */
+struct absinthe_reply
+{
+    void* context;
+    void (*reply)(void* context, const char* text, size_t length);
+};
+
+/* Returns 0 on success. A nonzero result tells the sender the command failed. */
+typedef int (*absinthe_command_fn)(void* user_data, const char* const* args, size_t arg_count,
+    const struct absinthe_reply* reply);
+
+struct absinthe_command
+{
+    const char* name;
+    const char* usage;
+    absinthe_command_fn run;
+};
+
+struct absinthe_plugin
+{
+    uint32_t abi_version;
+    const char* name;
+    const struct absinthe_command* commands;
+    size_t command_count;
+    void* user_data;
+    /* Optional, called before the library is closed. */
+    void (*shutdown)(void* user_data);
+};
+
+typedef const struct absinthe_plugin* (*absinthe_plugin_init_fn)(void);
+
+#ifdef __cplusplus
+}
+#endif
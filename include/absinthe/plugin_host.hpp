@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "absinthe/plugin_api.h"
+
+namespace absinthe
+{
+    // Loads command plugins (see plugin_api.h) from a directory. A load builds
+    // a complete new table that is only staged; Commit swaps it in, which the
+    // chat loop does at a tick boundary, so a reload is atomic with respect to
+    // command dispatch. Find hands out shared_ptrs into the active table, and
+    // a table closes its libraries only once the last of them is released,
+    // which drains invocations still running against the old plugins.
+    class PluginHost
+    {
+    public:
+        struct Command
+        {
+            std::string name;
+            std::string usage;
+            std::string plugin;
+            absinthe_command_fn run = nullptr;
+            void* user_data = nullptr;
+        };
+
+        using ReplyFn = std::function<void(std::string_view)>;
+
+        // Stages every *.so in directory. Commands for which is_reserved
+        // returns true are skipped with a warning. Nothing is staged if any
+        // plugin fails to load.
+        bool LoadDirectory(const std::string& directory, const std::function<bool(const std::string&)>& is_reserved,
+            std::string* error = nullptr);
+        // Returns true if a staged table replaced the active one.
+        bool Commit();
+        bool HasStaged() const;
+
+        std::shared_ptr<const Command> Find(const std::string& name) const;
+        std::vector<std::string> GetCommandNames() const;
+        std::string Describe() const;
+
+        static bool Invoke(const Command& command, const std::vector<std::string>& args, const ReplyFn& reply);
+
+    private:
+        struct Library;
+
+        struct Table
+        {
+            std::vector<std::shared_ptr<Library>> libraries;
+            std::unordered_map<std::string, Command> commands;
+        };
+
+        static std::shared_ptr<Library> OpenLibrary(const std::string& path, std::string* error);
+
+        std::shared_ptr<const Table> active_;
+        std::shared_ptr<const Table> staged_;
+    };
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace absinthe
+{
+    struct ProfileCounters
+    {
+        std::uint64_t allocations = 0;
+        std::uint64_t bytes = 0;
+        std::uint64_t cpu_ns = 0;
+    };
+
+    // Allocation and CPU accounting per trace span, compiled in with
+    // ABSINTHE_ENABLE_PROFILING. A replaced global operator new counts
+    // allocations per thread; every TraceSpan samples those counters and the
+    // thread's CPU clock on entry and adds the difference to its stage (and
+    // command name, for command spans) on exit. Nested spans are inclusive.
+    class Profiler
+    {
+    public:
+        static constexpr bool IsCompiled()
+        {
+#if USE_PROFILING
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        static ProfileCounters Sample();
+        static void Record(const char* name, const char* detail, const ProfileCounters& start);
+        static std::string FormatReport(std::size_t max_rows = 0);
+        static void Reset();
+    };
+}
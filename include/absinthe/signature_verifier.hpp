@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absinthe/chat_client.hpp"
+
+namespace absinthe
+{
+    // Verifies secure-chat signatures of command candidates against the
+    // sender's profile public key. The network thread only resolves the
+    // last-seen references and builds the signed payload; RSA verification
+    // runs on a small worker pool, sharded by sender so a player's commands
+    // stay in order. Verified messages are pushed to the originating inbox.
+    // The profile key itself is taken as the server relays it: its Mojang
+    // signature is not checked, so a hostile server can vouch for anyone.
+    class ChatSignatureVerifier
+    {
+    public:
+        static constexpr std::size_t kSignatureSize = 256;
+        using Signature = std::array<unsigned char, kSignatureSize>;
+
+        ChatSignatureVerifier(std::string prefix, std::size_t worker_count);
+        ~ChatSignatureVerifier();
+
+        ChatSignatureVerifier(const ChatSignatureVerifier&) = delete;
+        ChatSignatureVerifier& operator=(const ChatSignatureVerifier&) = delete;
+
+        static bool IsSupported();
+        void Stop();
+        // Call once the connection's network thread has stopped: waits for
+        // queued jobs to reach their inbox, then forgets the last-seen cache
+        // and session keys, which belong to that connection.
+        void ResetConnection();
+        // Registers a player's chat session; der is the profile public key as
+        // sent in player info updates. Returns false if the key is unreadable.
+        bool AddSession(const ProtocolCraft::UUID& player, const ProtocolCraft::UUID& session_id, long long expires_at_ms,
+            const std::vector<unsigned char>& der);
+
+#if PROTOCOL_VERSION > 760 /* > 1.19.2 */
+        void UpdateSessions(const ProtocolCraft::ClientboundPlayerInfoUpdatePacket& packet);
+        void RemoveSessions(const ProtocolCraft::ClientboundPlayerInfoRemovePacket& packet);
+        bool Submit(const ProtocolCraft::ClientboundPlayerChatPacket& packet, ChatMessage& message, ChatInbox& destination);
+#endif
+
+    private:
+        struct PlayerKey;
+
+        struct Job
+        {
+            std::shared_ptr<const PlayerKey> key;
+            std::vector<unsigned char> payload;
+            Signature signature{};
+            ChatMessage message;
+            ChatInbox* destination = nullptr;
+        };
+
+        struct Worker
+        {
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::condition_variable idle;
+            std::deque<Job> jobs;
+            bool busy = false;
+            std::thread thread;
+        };
+
+        void WorkerLoop(Worker& worker);
+        void PushSignatures(std::vector<Signature> signatures);
+
+        std::string prefix_;
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::atomic<bool> stopping_{ false };
+
+        std::mutex keys_mutex_;
+        std::map<ProtocolCraft::UUID, std::shared_ptr<const PlayerKey>> keys_;
+
+        // Receiver-side copy of the last-seen signature cache, only touched
+        // from the network thread.
+        std::array<std::optional<Signature>, 128> signature_cache_;
+    };
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace absinthe
+{
+    enum class ThreadRole
+    {
+        Network,
+        Behaviour,
+        Persistence,
+        Logging
+    };
+
+    // Per-role CPU sets and nice values, applied by each thread to itself when
+    // it starts. Threads Botcraft starts in Connect inherit the placement of
+    // the thread that runs it, and its packet thread registers itself once
+    // the login packet arrives.
+    class ThreadLayout
+    {
+    public:
+        static ThreadLayout& GetInstance();
+
+        static std::optional<ThreadRole> ParseRole(const std::string& name);
+        static const char* GetRoleName(ThreadRole role);
+        static std::vector<pid_t> ListThreads();
+
+        // spec is "<role>=<cpu list>" (e.g. "network=2-3,6") or "<role>=<nice>".
+        bool SetCpus(const std::string& spec, std::string* error = nullptr);
+        bool SetNice(const std::string& spec, std::string* error = nullptr);
+
+        void ApplyToCurrentThread(ThreadRole role, const char* name);
+        // Keeps the name the thread already has.
+        void RegisterCurrentThread(ThreadRole role);
+        // Runs fn on a short-lived thread placed in role and waits for it, so
+        // threads fn starts inherit the role's CPUs, nice value and name.
+        void RunInRole(ThreadRole role, const char* name, const std::function<void()>& fn);
+        std::string FormatReport() const;
+
+    private:
+        struct RoleConfig
+        {
+            std::vector<int> cpus;
+            std::optional<int> nice;
+        };
+
+        struct Placement
+        {
+            ThreadRole role = ThreadRole::Network;
+            pid_t tid = 0;
+            std::string name;
+            std::string error;
+        };
+
+        ThreadLayout() = default;
+
+        void Apply(ThreadRole role, pid_t tid, const std::string& name, bool record);
+
+        mutable std::mutex mutex;
+        std::array<RoleConfig, 4> roles;
+        std::vector<Placement> placements;
+    };
+}
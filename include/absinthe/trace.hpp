@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "absinthe/profiler.hpp"
+
+namespace absinthe
+{
+    // Span recorder for Chrome/Perfetto traces. Each thread appends to its own
+    // single-producer ring; a background thread drains the rings into a JSON
+    // trace file. When tracing is off a span costs one relaxed load.
+    class Tracer
+    {
+    public:
+        static bool Start(const std::string& path, std::string* error = nullptr);
+        static void Stop();
+        static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+        static std::uint64_t Now();
+        static void Record(const char* name, std::uint64_t start_ns, std::uint64_t end_ns, const char* detail = nullptr);
+        static void SetThreadName(const char* name);
+
+    private:
+        static inline std::atomic<bool> enabled{ false };
+    };
+
+    class TraceSpan
+    {
+    public:
+        explicit TraceSpan(const char* name, const char* detail = nullptr)
+            : name_(Tracer::IsEnabled() ? name : nullptr)
+            , detail_(detail)
+            , start_(name_ ? Tracer::Now() : 0)
+#if USE_PROFILING
+            , profile_name_(name)
+            , profile_start_(Profiler::Sample())
+#endif
+        {
+        }
+
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+        ~TraceSpan()
+        {
+            End();
+        }
+
+        void End()
+        {
+            if (name_)
+            {
+                Tracer::Record(name_, start_, Tracer::Now(), detail_);
+                name_ = nullptr;
+            }
+#if USE_PROFILING
+            if (profile_name_)
+            {
+                Profiler::Record(profile_name_, detail_, profile_start_);
+                profile_name_ = nullptr;
+            }
+#endif
+        }
+
+    private:
+        const char* name_;
+        const char* detail_;
+        std::uint64_t start_;
+#if USE_PROFILING
+        const char* profile_name_;
+        ProfileCounters profile_start_;
+#endif
+    };
+}
+
+#define ABSINTHE_TRACE_CONCAT_INNER(a, b) a##b
+#define ABSINTHE_TRACE_CONCAT(a, b) ABSINTHE_TRACE_CONCAT_INNER(a, b)
+#define ABSINTHE_TRACE_SPAN(...) ::absinthe::TraceSpan ABSINTHE_TRACE_CONCAT(trace_span_, __LINE__)(__VA_ARGS__)
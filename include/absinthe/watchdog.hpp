@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <pthread.h>
+
+namespace absinthe
+{
+    // Watches the heartbeat stamped by every chat tick. When a tick runs past
+    // the budget, or ticks stop arriving, it logs what was running, samples
+    // the stalled thread's stack and bumps the stall metrics. The tick
+    // metrics are published from the ticks themselves, with or without a
+    // budget.
+    class Watchdog
+    {
+    public:
+        Watchdog() = default;
+        ~Watchdog();
+
+        Watchdog(const Watchdog&) = delete;
+        Watchdog& operator=(const Watchdog&) = delete;
+
+        void Start(std::chrono::milliseconds budget);
+        void Stop();
+
+        void BeginTick();
+        void EndTick();
+        // Stops the no-tick check until the next BeginTick, for gaps where no
+        // client is active, such as the reconnect backoff.
+        void Pause();
+        void SetActivity(const std::string& activity);
+
+        std::uint64_t GetStallCount() const;
+        std::chrono::microseconds GetLongestTick() const;
+
+    private:
+        void Run();
+        void ReportStall(std::uint64_t elapsed_ns, bool in_tick);
+        void PublishMetrics();
+
+        std::chrono::milliseconds budget_{ 0 };
+        std::thread thread_;
+        std::mutex stop_mutex_;
+        std::condition_variable stop_cv_;
+        bool stopping_ = false;
+
+        std::atomic<std::uint64_t> tick_start_ns_{ 0 };
+        std::atomic<std::uint64_t> last_heartbeat_ns_{ 0 };
+        std::atomic<std::uint64_t> tick_count_{ 0 };
+        std::atomic<std::uint64_t> longest_tick_ns_{ 0 };
+        std::atomic<std::uint64_t> stall_count_{ 0 };
+        std::uint64_t published_ns_ = 0;
+        std::atomic<pthread_t> tick_thread_{};
+        std::atomic<bool> has_tick_thread_{ false };
+
+        mutable std::mutex activity_mutex_;
+        std::string activity_ = "idle";
+    };
+}
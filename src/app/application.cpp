@@ -1,20 +1,45 @@
 #include "absinthe/application.hpp"
+#include "absinthe/audit_log.hpp"
+#include "absinthe/chat_archive.hpp"
 #include "absinthe/chat_client.hpp"
 #include "absinthe/chat_handler.hpp"
+#include "absinthe/chat_history.hpp"
+#include "absinthe/chat_only_client.hpp"
+#include "absinthe/chat_triggers.hpp"
 #include "absinthe/chat_whitelist.hpp"
+#include "absinthe/command_task.hpp"
+#include "absinthe/control_socket.hpp"
+#include "absinthe/metrics.hpp"
+#include "absinthe/plugin_host.hpp"
+#include "absinthe/profiler.hpp"
+#include "absinthe/signature_verifier.hpp"
+#include "absinthe/thread_layout.hpp"
+#include "absinthe/trace.hpp"
+#include "absinthe/watchdog.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <chrono>
+#include <ctime>
 #include <deque>
 #include <filesystem>
+#include <future>
+#include <iomanip>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <random>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include <sys/resource.h>
+
 #include "botcraft/AI/BehaviourTree.hpp"
+#include "botcraft/Network/NetworkManager.hpp"
 #include "botcraft/Utilities/Logger.hpp"
 #include "botcraft/Utilities/SleepUtilities.hpp"
 #include "protocolCraft/enums.hpp"
@@ -28,9 +53,47 @@ namespace absinthe
             std::string address = "127.0.0.1:25565";
             std::string login = "absinthe";
             std::vector<std::string> allow_list;
+            std::string trace_path;
+            std::string metrics_path;
+            std::string archive_path;
+            std::string control_path;
+            std::string plugins_path;
+            std::string audit_path;
+            std::vector<std::string> thread_cpus;
+            std::vector<std::string> thread_nice;
+            std::string standby_login;
+            int tick_budget_ms = 250;
+            int verify_threads = 2;
+            int history_size = 4096;
+            int history_bytes = 1 << 20;
+            int reconnect_max_seconds = 60;
+            bool verify_signatures = false;
+            bool chat_only = false;
             int return_code = 0;
         };
 
+        std::optional<int> ParseInteger(const std::string& value, const int max)
+        {
+            if (value.empty() || value.size() > 9)
+            {
+                return std::nullopt;
+            }
+            int result = 0;
+            for (const char c : value)
+            {
+                if (std::isdigit(static_cast<unsigned char>(c)) == 0)
+                {
+                    return std::nullopt;
+                }
+                result = result * 10 + (c - '0');
+            }
+            if (result > max)
+            {
+                return std::nullopt;
+            }
+            return result;
+        }
+
         Args ParseCommandLine(int argc, char* argv[])
         {
             Args args;
@@ -75,6 +138,183 @@ namespace absinthe
                     return args;
                 }
 
+                if (arg == "--trace")
+                {
+                    if (i + 1 < argc)
+                    {
+                        args.trace_path = argv[++i];
+                        continue;
+                    }
+
+                    LOG_FATAL("--trace requires an argument");
+                    args.return_code = 1;
+                    return args;
+                }
+                if (arg == "--metrics-file")
+                {
+                    if (i + 1 < argc)
+                    {
+                        args.metrics_path = argv[++i];
+                        continue;
+                    }
+
+                    LOG_FATAL("--metrics-file requires an argument");
+                    args.return_code = 1;
+                    return args;
+                }
+                if (arg == "--archive")
+                {
+                    if (i + 1 < argc)
+                    {
+                        args.archive_path = argv[++i];
+                        continue;
+                    }
+
+                    LOG_FATAL("--archive requires an argument");
+                    args.return_code = 1;
+                    return args;
+                }
+                if (arg == "--control")
+                {
+                    if (i + 1 < argc)
+                    {
+                        args.control_path = argv[++i];
+                        continue;
+                    }
+
+                    LOG_FATAL("--control requires an argument");
+                    args.return_code = 1;
+                    return args;
+                }
+                if (arg == "--thread-cpus" || arg == "--thread-nice")
+                {
+                    if (i + 1 < argc)
+                    {
+                        (arg == "--thread-cpus" ? args.thread_cpus : args.thread_nice).push_back(argv[++i]);
+                        continue;
+                    }
+
+                    LOG_FATAL(arg << " requires <role>=<value>");
+                    args.return_code = 1;
+                    return args;
+                }
+                if (arg == "--tick-budget")
+                {
+                    const std::optional<int> budget = i + 1 < argc ? ParseInteger(argv[i + 1], 600000) : std::nullopt;
+                    if (budget.has_value())
+                    {
+                        args.tick_budget_ms = budget.value();
+                        ++i;
+                        continue;
+                    }
+
+                    LOG_FATAL("--tick-budget requires a duration in milliseconds");
+                    args.return_code = 1;
+                    return args;
+                }
+                if (arg == "--audit")
+                {
+                    if (i + 1 < argc)
+                    {
+                        args.audit_path = argv[++i];
+                        continue;
+                    }
+
+                    LOG_FATAL("--audit requires a path");
+                    args.return_code = 1;
+                    return args;
+                }
+                if (arg == "--plugins")
+                {
+                    if (i + 1 < argc)
+                    {
+                        args.plugins_path = argv[++i];
+                        continue;
+                    }
+
+                    LOG_FATAL("--plugins requires a directory");
+                    args.return_code = 1;
+                    return args;
+                }
+                if (arg == "--reconnect-max")
+                {
+                    const std::optional<int> seconds = i + 1 < argc ? ParseInteger(argv[i + 1], 3600) : std::nullopt;
+                    if (seconds.has_value())
+                    {
+                        args.reconnect_max_seconds = seconds.value();
+                        ++i;
+                        continue;
+                    }
+
+                    LOG_FATAL("--reconnect-max requires a delay in seconds up to 3600");
+                    args.return_code = 1;
+                    return args;
+                }
+                if (arg == "--history")
+                {
+                    const std::optional<int> size = i + 1 < argc ? ParseInteger(argv[i + 1], 1000000) : std::nullopt;
+                    if (size.has_value() && size.value() > 0)
+                    {
+                        args.history_size = size.value();
+                        ++i;
+                        continue;
+                    }
+
+                    LOG_FATAL("--history requires a message count between 1 and 1000000");
+                    args.return_code = 1;
+                    return args;
+                }
+                if (arg == "--history-bytes")
+                {
+                    const std::optional<int> bytes = i + 1 < argc ? ParseInteger(argv[i + 1], 256 << 20) : std::nullopt;
+                    if (bytes.has_value())
+                    {
+                        args.history_bytes = bytes.value();
+                        ++i;
+                        continue;
+                    }
+
+                    LOG_FATAL("--history-bytes requires a size in bytes up to 256 MiB");
+                    args.return_code = 1;
+                    return args;
+                }
+                if (arg == "--verify-signatures")
+                {
+                    args.verify_signatures = true;
+                    continue;
+                }
+                if (arg == "--verify-threads")
+                {
+                    const std::optional<int> threads = i + 1 < argc ? ParseInteger(argv[i + 1], 64) : std::nullopt;
+                    if (threads.has_value() && threads.value() > 0)
+                    {
+                        args.verify_threads = threads.value();
+                        ++i;
+                        continue;
+                    }
+
+                    LOG_FATAL("--verify-threads requires a thread count between 1 and 64");
+                    args.return_code = 1;
+                    return args;
+                }
+                if (arg == "--standby-login")
+                {
+                    if (i + 1 < argc && argv[i + 1][0] != '-')
+                    {
+                        args.standby_login = argv[++i];
+                        continue;
+                    }
+
+                    LOG_FATAL("--standby-login requires an argument");
+                    args.return_code = 1;
+                    return args;
+                }
+                if (arg == "--chat-only")
+                {
+                    args.chat_only = true;
+                    continue;
+                }
+
                 LOG_FATAL("Unknown argument: " << arg);
                 args.return_code = 1;
                 return args;
@@ -107,6 +347,7 @@ namespace absinthe
         {
             auto stdin_queue = std::make_shared<StdinQueue>();
             std::thread stdin_thread([stdin_queue]() {
+                ThreadLayout::GetInstance().ApplyToCurrentThread(ThreadRole::Logging, "stdin");
                 std::string line;
                 while (std::getline(std::cin, line))
                 {
@@ -118,7 +359,9 @@ namespace absinthe
             return stdin_queue;
         }
 
-        void LoadWhitelist(ChatWhitelist& whitelist, const std::string& path, const std::vector<std::string>& entries)
+        // Returns whether --allow entries were added; saving them is left to
+        // the first chat tick so startup does not wait on the disk write.
+        bool LoadWhitelist(ChatWhitelist& whitelist, const std::string& path, const std::vector<std::string>& entries)
         {
             if (std::filesystem::exists(path))
             {
@@ -137,19 +380,33 @@ namespace absinthe
             {
                 whitelist.AddEntry(entry);
             }
+            return !entries.empty();
+        }
 
-            if (!entries.empty())
+        void LoadTriggers(ChatTriggers& triggers, const std::string& path)
+        {
+            if (!std::filesystem::exists(path))
             {
-                std::string error;
-                if (!whitelist.SaveToFile(path, &error))
-                {
-                    LOG_ERROR(error);
-                }
+                return;
+            }
+
+            std::string error;
+            if (!triggers.LoadFromFile(path, &error))
+            {
+                LOG_ERROR(error);
+            }
+            else
+            {
+                // Nothing matches before the config is loaded, so this can go live at once.
+                triggers.Commit();
+                LOG_INFO("Loaded triggers from " << path << ": " << triggers.Describe());
             }
         }
 
         Botcraft::Status AwaitPlayState(ChatBehaviourClient& client)
         {
+            Tracer::SetThreadName("behaviour");
+            ThreadLayout::GetInstance().ApplyToCurrentThread(ThreadRole::Behaviour, "behaviour");
             const bool ready = Botcraft::Utilities::YieldForCondition([&]() {
                 const auto manager = client.GetNetworkManager();
                 return manager && manager->GetConnectionState() == ProtocolCraft::ConnectionState::Play;
@@ -162,184 +419,1484 @@ namespace absinthe
                 return Botcraft::Status::Failure;
             }
 
+            LOG_INFO(ThreadLayout::GetInstance().FormatReport());
+
             return Botcraft::Status::Success;
         }
 
-        Botcraft::Status HandleChatLoop(ChatBehaviourClient& client,
-            ChatHandler& chat_handler,
-            ChatWhitelist& whitelist,
-            const std::string& whitelist_path,
-            const std::shared_ptr<StdinQueue>& stdin_queue)
+        // Wall time of each startup phase. Main-thread phases are consecutive;
+        // parallel ones (the config load) overlap connect and login.
+        struct StartupTimeline
         {
-            auto send_feedback = [&](const std::string& text, const bool from_console) {
-                if (from_console)
-                {
-                    LOG_INFO(text);
-                }
-                else
-                {
-                    client.SendChatMessage(text);
-                }
+            struct Phase
+            {
+                std::string name;
+                std::uint64_t duration_ns = 0;
+                bool parallel = false;
             };
 
-            auto persist_whitelist = [&]() {
-                std::string error;
-                if (!whitelist.SaveToFile(whitelist_path, &error))
-                {
-                    LOG_ERROR(error);
-                }
-            };
+            std::mutex mutex;
+            std::uint64_t start_ns = 0;
+            std::uint64_t last_ns = 0;
+            std::vector<Phase> phases;
+            std::atomic<bool> play_reported{ false };
+            std::atomic<bool> command_reported{ false };
+        };
 
-            auto handle_command = [&](const ChatParseResult& parsed, const bool from_console, const ChatMessage* message) {
-                if (!parsed.is_command)
-                {
-                    return;
-                }
+        void RecordPhase(StartupTimeline& startup, const std::string& name, const std::uint64_t duration_ns, const bool parallel)
+        {
+            {
+                std::lock_guard<std::mutex> lock(startup.mutex);
+                startup.phases.push_back({ name, duration_ns, parallel });
+            }
+            Metrics::GetInstance().Set("absinthe_startup_phase_seconds{phase=\"" + name + "\"}", duration_ns / 1e9);
+        }
 
-                if (!parsed.ok)
-                {
-                    send_feedback(parsed.error, from_console);
-                    return;
-                }
+        void MarkPhase(StartupTimeline& startup, const std::string& name)
+        {
+            const std::uint64_t now = Tracer::Now();
+            std::uint64_t begin = 0;
+            {
+                std::lock_guard<std::mutex> lock(startup.mutex);
+                begin = startup.last_ns;
+                startup.last_ns = now;
+            }
+            RecordPhase(startup, name, now - begin, false);
+        }
 
-                if (!from_console)
-                {
-                    if (!message || !message->has_signature)
-                    {
-                        send_feedback("Secure chat signature missing. Commands require signed chat.", false);
-                        return;
-                    }
+        // Until a connection reaches play, each attempt restarts the connect
+        // phase, so it and login describe the attempt that got through rather
+        // than including earlier failures and their backoff. The total play
+        // time still counts from startup.
+        void BeginConnectAttempt(StartupTimeline& startup)
+        {
+            if (startup.play_reported)
+            {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(startup.mutex);
+            std::erase_if(startup.phases, [](const StartupTimeline::Phase& phase) { return phase.name == "connect"; });
+            startup.last_ns = Tracer::Now();
+        }
 
-                    if (!whitelist.IsAllowed(*message))
-                    {
-                        send_feedback("You are not authorized to issue commands.", false);
-                        return;
-                    }
-                }
+        std::string FormatStartup(StartupTimeline& startup)
+        {
+            std::lock_guard<std::mutex> lock(startup.mutex);
+            std::ostringstream stream;
+            stream << std::fixed << std::setprecision(1);
+            for (size_t i = 0; i < startup.phases.size(); ++i)
+            {
+                const StartupTimeline::Phase& phase = startup.phases[i];
+                stream << (i == 0 ? "" : ", ") << phase.name << ' ' << phase.duration_ns / 1e6 << " ms"
+                    << (phase.parallel ? " (parallel)" : "");
+            }
+            return stream.str();
+        }
 
-                if (parsed.command.name == "allow")
-                {
-                    if (parsed.command.args.empty())
-                    {
-                        send_feedback("Malformed command. Usage: " + chat_handler.GetPrefix() + " allow <name|uuid>.", from_console);
-                        return;
-                    }
+        struct CommandContext;
+        // Built-in command handlers are looked up by command id.
+        using CommandHandler = CommandTask (*)(CommandContext context);
 
-                    int added = 0;
-                    for (const auto& entry : parsed.command.args)
-                    {
-                        if (whitelist.AddEntry(entry))
-                        {
-                            ++added;
-                        }
-                    }
-                    if (added == 0)
-                    {
-                        send_feedback("No new entries added to allowlist.", from_console);
-                    }
-                    else
-                    {
-                        send_feedback("Allowlist updated. Added " + std::to_string(added) + " entr"
-                            + (added == 1 ? "y." : "ies."), from_console);
-                        persist_whitelist();
-                    }
-                    return;
-                }
+        struct BotState
+        {
+            ChatHandler chat_handler;
+            ChatWhitelist whitelist;
+            std::string whitelist_path = "whitelist.yaml";
+            ChatTriggers triggers;
+            std::unique_ptr<ChatHistory> history;
+            std::unique_ptr<ChatArchive> archive;
+            std::unique_ptr<AuditLog> audit;
+            std::unique_ptr<ControlSocket> control;
+            std::string triggers_path = "triggers.yaml";
+            PluginHost plugins;
+            std::string plugins_path;
+            std::shared_ptr<StdinQueue> stdin_queue;
+            CommandScheduler scheduler;
+            Watchdog watchdog;
+            std::unique_ptr<ChatSignatureVerifier> signature_verifier;
+            std::unique_ptr<ChatSignatureVerifier> standby_verifier;
 
-                if (parsed.command.name == "deny")
-                {
-                    if (parsed.command.args.empty())
-                    {
-                        send_feedback("Malformed command. Usage: " + chat_handler.GetPrefix() + " deny <name|uuid>.", from_console);
-                        return;
-                    }
+            // Set when the primary connection drops and cleared once a new one
+            // reaches Play, so failed attempts count towards the same outage.
+            std::atomic<std::uint64_t> disconnected_ns{ 0 };
 
-                    int removed = 0;
-                    for (const auto& entry : parsed.command.args)
-                    {
-                        if (whitelist.RemoveEntry(entry))
-                        {
-                            ++removed;
-                        }
-                    }
-                    if (removed == 0)
-                    {
-                        send_feedback("No matching entries found in allowlist.", from_console);
-                    }
-                    else
-                    {
-                        send_feedback("Allowlist updated. Removed " + std::to_string(removed) + " entr"
-                            + (removed == 1 ? "y." : "ies."), from_console);
-                        persist_whitelist();
-                    }
-                    return;
-                }
+            StartupTimeline startup;
+            // Allowlist, triggers and plugins load while the client connects; anything
+            // that reads them waits on this first.
+            std::shared_future<void> config_loaded;
+
+            // Everything below is shared by the primary and standby clients'
+            // behaviour threads and guarded by dispatch_mutex. Only the active
+            // client runs the command pipeline.
+            std::mutex dispatch_mutex;
+            ChatEndpoint* primary = nullptr;
+            ChatEndpoint* standby = nullptr;
+            ChatEndpoint* active = nullptr;
+            // Our logins, whose own chat echoes back and is never dispatched.
+            std::vector<ProtocolCraft::UUID> own_uuids;
+            std::deque<std::string> outbound;
+            std::deque<ChatMessage> standby_backlog;
+            std::uint64_t last_dispatch_ns = 0;
+            bool whitelist_dirty = false;
+            // Set once the primary gives up, so the standby stops reconnecting.
+            bool closing = false;
+            std::vector<CommandHandler> command_handlers;
+        };
+
+        // Where a command came from and where its replies go: in-game chat, the
+        // log for stdin, or the JSON response of a control socket request.
+        struct ReplyTarget
+        {
+            enum class Kind
+            {
+                Chat,
+                Console,
+                Control
+            };
 
-                if (parsed.command.name == "list")
+            Kind kind = Kind::Chat;
+            std::shared_ptr<ControlRequest> request;
+        };
+
+        // Splits text into chat messages the server accepts, at spaces where
+        // possible and never inside a UTF-8 sequence.
+        void QueueChat(BotState& state, const std::string& text)
+        {
+            size_t start = 0;
+            while (text.size() - start > ChatHandler::kMaxChatLength)
+            {
+                size_t end = text.rfind(' ', start + ChatHandler::kMaxChatLength);
+                if (end == std::string::npos || end <= start)
                 {
-                    send_feedback(whitelist.FormatEntries(), from_console);
-                    return;
+                    end = start + ChatHandler::kMaxChatLength;
+                    while (end > start + 1 && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80)
+                    {
+                        --end;
+                    }
                 }
-
-                std::optional<std::string> response = chat_handler.HandleCommand(parsed.command);
-                if (response.has_value())
+                state.outbound.push_back(text.substr(start, end - start));
+                start = end;
+                while (start < text.size() && text[start] == ' ')
                 {
-                    send_feedback(response.value(), from_console);
+                    ++start;
                 }
-            };
+            }
+            if (start < text.size() || text.empty())
+            {
+                state.outbound.push_back(text.substr(start));
+            }
+        }
 
-            auto parse_console = [&](const std::string& line) {
-                std::string trimmed = Trim(line);
-                if (trimmed.empty())
+        void SendFeedback(BotState& state, const std::string& text, const ReplyTarget& target)
+        {
+            switch (target.kind)
+            {
+            case ReplyTarget::Kind::Chat:
+                QueueChat(state, text);
+                return;
+            case ReplyTarget::Kind::Console:
+                LOG_INFO(text);
+                return;
+            case ReplyTarget::Kind::Control:
+                if (!target.request->completed)
                 {
-                    return ChatParseResult{};
+                    target.request->replies.push_back(text);
                 }
-
-                if (trimmed.rfind(chat_handler.GetPrefix(), 0) != 0)
+                else if (state.control)
                 {
-                    trimmed = chat_handler.GetPrefix() + " " + trimmed;
+                    state.control->SendLate(*target.request, text);
                 }
+                return;
+            }
+        }
 
-                return chat_handler.Parse(trimmed);
-            };
-
-            ChatMessage message;
-            while (client.PopChatMessage(message))
+        void WaitForConfig(BotState& state)
+        {
+            std::shared_future<void> config_loaded = state.config_loaded;
+            if (config_loaded.valid())
             {
-                ChatParseResult parsed = chat_handler.Parse(message.content);
-                handle_command(parsed, false, &message);
+                config_loaded.wait();
             }
+        }
 
-            std::deque<std::string> pending;
+        void RememberOwnUUID(BotState& state, const Botcraft::ConnectionClient& client)
+        {
+            const auto manager = client.GetNetworkManager();
+            if (!manager)
             {
-                std::lock_guard<std::mutex> lock(stdin_queue->mutex);
-                pending.swap(stdin_queue->lines);
+                return;
             }
-
-            for (const auto& line : pending)
+            const ProtocolCraft::UUID uuid = manager->GetMyUUID();
+            std::lock_guard<std::mutex> lock(state.dispatch_mutex);
+            if (std::find(state.own_uuids.begin(), state.own_uuids.end(), uuid) == state.own_uuids.end())
             {
-                ChatParseResult parsed = parse_console(line);
-                handle_command(parsed, true, nullptr);
+                state.own_uuids.push_back(uuid);
             }
-
-            client.Yield();
-            return Botcraft::Status::Failure;
         }
 
-        auto BuildBehaviourTree(ChatHandler& chat_handler,
-            ChatWhitelist& whitelist,
-            const std::string& whitelist_path,
-            const std::shared_ptr<StdinQueue>& stdin_queue)
+        void MarkConnected(BotState& state)
+        {
+            StartupTimeline& startup = state.startup;
+            if (!startup.play_reported.exchange(true))
+            {
+                MarkPhase(startup, "login");
+                WaitForConfig(state);
+                MarkPhase(startup, "config wait");
+                const double seconds = (Tracer::Now() - startup.start_ns) / 1e9;
+                Metrics::GetInstance().Set("absinthe_startup_play_seconds", seconds);
+                LOG_INFO("Startup: " << FormatStartup(startup) << "; in Play after " << seconds * 1000.0 << " ms");
+            }
+            WaitForConfig(state);
+
+            const std::uint64_t now = Tracer::Now();
+            const std::uint64_t disconnected = state.disconnected_ns.exchange(0);
+            if (disconnected == 0)
+            {
+                return;
+            }
+
+            size_t pending = 0;
+            {
+                std::lock_guard<std::mutex> lock(state.dispatch_mutex);
+                pending = state.outbound.size();
+            }
+            const double seconds = (now - disconnected) / 1e9;
+            Metrics::GetInstance().Set("absinthe_reconnect_recovery_seconds", seconds);
+            Metrics::GetInstance().Add("absinthe_reconnects_total", 1);
+            LOG_INFO("Recovered " << seconds << " s after the connection dropped (" << pending << " replies pending)");
+        }
+
+        // Exponential with equal jitter: half of each delay is fixed and half
+        // random, so bots dropped by the same outage do not retry in lockstep.
+        // One per reconnect loop. Only the primary's outages feed the
+        // recovery metrics.
+        struct ReconnectBackoff
+        {
+            std::chrono::milliseconds max_delay;
+            const char* name = "Connection";
+            bool track_recovery = true;
+            int attempts = 0;
+            std::mt19937 random{ std::random_device{}() };
+            std::atomic<std::uint64_t> play_since_ns{ 0 };
+        };
+
+        std::chrono::milliseconds NextReconnectDelay(ReconnectBackoff& backoff)
+        {
+            constexpr std::chrono::milliseconds kInitialDelay(1000);
+            const std::chrono::milliseconds ceiling = std::min(backoff.max_delay,
+                std::chrono::milliseconds(kInitialDelay.count() << std::min(backoff.attempts, 16)));
+            ++backoff.attempts;
+            std::uniform_int_distribution<long long> jitter(0, ceiling.count() / 2);
+            return ceiling - ceiling / 2 + std::chrono::milliseconds(jitter(backoff.random));
+        }
+
+        // Returns false when reconnecting is disabled. A session that stayed in
+        // Play for a while starts the backoff over.
+        bool WaitBeforeReconnect(const Args& args, BotState& state, ReconnectBackoff& backoff)
+        {
+            constexpr std::uint64_t kStableSessionNs = 60'000'000'000ull;
+            if (args.reconnect_max_seconds == 0)
+            {
+                return false;
+            }
+
+            const std::uint64_t now = Tracer::Now();
+            const std::uint64_t play_since = backoff.play_since_ns.exchange(0);
+            if (play_since != 0 && now - play_since >= kStableSessionNs)
+            {
+                backoff.attempts = 0;
+            }
+            if (backoff.track_recovery)
+            {
+                std::uint64_t expected = 0;
+                state.disconnected_ns.compare_exchange_strong(expected, now);
+            }
+
+            const std::chrono::milliseconds delay = NextReconnectDelay(backoff);
+            LOG_WARNING(backoff.name << " closed, reconnecting in " << delay.count() << " ms (attempt " << backoff.attempts << ")");
+            std::this_thread::sleep_for(delay);
+            return true;
+        }
+
+        void FlushOutbound(ChatEndpoint& client, BotState& state)
+        {
+            while (!state.outbound.empty() && client.IsConnected())
+            {
+                ABSINTHE_TRACE_SPAN("send chat");
+                client.SendChat(state.outbound.front());
+                state.outbound.pop_front();
+            }
+        }
+
+        // Runs on the standby's thread while the active client is healthy. Chat
+        // is kept for a few seconds so a takeover can replay what the primary
+        // received but never dispatched.
+        void BufferStandbyChat(ChatEndpoint& client, BotState& state)
+        {
+            constexpr std::uint64_t kBacklogWindowNs = 5'000'000'000ull;
+            ChatMessage message;
+            while (client.PopChatMessage(message))
+            {
+                state.standby_backlog.push_back(std::move(message));
+            }
+
+            const std::uint64_t now = Tracer::Now();
+            while (!state.standby_backlog.empty() && now - state.standby_backlog.front().received_ns > kBacklogWindowNs)
+            {
+                state.standby_backlog.pop_front();
+            }
+        }
+
+        void PersistWhitelist(BotState& state)
+        {
+            ABSINTHE_TRACE_SPAN("save allowlist");
+            std::string error;
+            if (!state.whitelist.SaveToFile(state.whitelist_path, &error))
+            {
+                LOG_ERROR(error);
+            }
+        }
+
+        std::optional<int> ParseSeconds(const std::string& value)
+        {
+            const std::optional<int> seconds = ParseInteger(value, 86400);
+            if (!seconds.has_value() || seconds.value() == 0)
+            {
+                return std::nullopt;
+            }
+            return seconds;
+        }
+
+        struct AllowlistResult
+        {
+            bool handled = false;
+            bool ok = false;
+            bool changed = false;
+            std::string reply;
+        };
+
+        AllowlistResult ApplyAllowlistCommand(ChatWhitelist& whitelist, const ChatCommand& command, const std::string& prefix)
+        {
+            AllowlistResult result;
+            if (command.name == "allow" || command.name == "deny")
+            {
+                const bool allow = command.name == "allow";
+                result.handled = true;
+
+                // A trailing role name applies to every listed entry.
+                std::vector<std::string> entries = command.args;
+                std::string role;
+                if (entries.size() > 1 && whitelist.HasRole(entries.back()))
+                {
+                    role = entries.back();
+                    entries.pop_back();
+                }
+                if (entries.empty())
+                {
+                    result.reply = "Malformed command. Usage: " + prefix + " " + command.name + " <name|uuid>... [role].";
+                    return result;
+                }
+
+                int updated = 0;
+                for (const auto& entry : entries)
+                {
+                    const bool changed = allow
+                        ? whitelist.AddEntry(entry, role.empty() ? ChatWhitelist::kDefaultRole : role)
+                        : whitelist.RemoveEntry(entry, role);
+                    if (changed)
+                    {
+                        ++updated;
+                    }
+                }
+                result.ok = true;
+                result.changed = updated > 0;
+                const std::string count = std::to_string(updated) + " entr" + (updated == 1 ? "y" : "ies");
+                const std::string as_role = role.empty() ? "" : " as " + role;
+                if (allow)
+                {
+                    result.reply = updated == 0
+                        ? "No new entries added to allowlist."
+                        : "Allowlist updated. Added " + count + as_role + ".";
+                }
+                else
+                {
+                    result.reply = updated == 0
+                        ? "No matching entries found in allowlist."
+                        : role.empty()
+                        ? "Allowlist updated. Removed " + count + "."
+                        : "Allowlist updated. Removed role " + role + " from " + count + ".";
+                }
+                return result;
+            }
+
+            if (command.name == "list")
+            {
+                result.handled = true;
+                result.ok = true;
+                result.reply = whitelist.FormatEntries();
+            }
+            return result;
+        }
+
+        // Applies every step to a copy of the allowlist; the copy only replaces
+        // the live one, and is only written to disk, if all steps validate.
+        bool RunBatch(BotState& state, const std::vector<ChatCommand>& batch, const ReplyTarget& target)
+        {
+            ABSINTHE_TRACE_SPAN("batch");
+            const std::string& prefix = state.chat_handler.GetPrefix();
+            ChatWhitelist staged = state.whitelist;
+            bool changed = false;
+            std::vector<std::string> replies;
+
+            for (size_t i = 0; i < batch.size(); ++i)
+            {
+                const AllowlistResult step = ApplyAllowlistCommand(staged, batch[i], prefix);
+                if (!step.handled)
+                {
+                    SendFeedback(state, "Batch rejected, nothing changed. Step " + std::to_string(i + 1) + ": \""
+                        + batch[i].name + "\" cannot be batched (only allow, deny and list).", target);
+                    return false;
+                }
+                if (!step.ok)
+                {
+                    SendFeedback(state, "Batch rejected, nothing changed. Step " + std::to_string(i + 1) + ": "
+                        + step.reply, target);
+                    return false;
+                }
+
+                changed = changed || step.changed;
+                if (!replies.empty() && replies.back().size() + 3 + step.reply.size() <= ChatHandler::kMaxChatLength)
+                {
+                    replies.back() += " | " + step.reply;
+                }
+                else
+                {
+                    replies.push_back(step.reply);
+                }
+            }
+
+            if (changed)
+            {
+                state.whitelist = std::move(staged);
+                PersistWhitelist(state);
+            }
+            for (const std::string& reply : replies)
+            {
+                SendFeedback(state, reply, target);
+            }
+            return true;
+        }
+
+        std::string FormatHistoryEntry(const ChatHistory::Entry& entry)
+        {
+            constexpr size_t kMaxQuoted = 100;
+            const auto age = std::chrono::duration_cast<std::chrono::seconds>(ChatHistory::Clock::now() - entry.received).count();
+            const std::string when = age < 120 ? std::to_string(age) + "s" : std::to_string(age / 60) + "m";
+            std::string content = entry.content.size() > kMaxQuoted ? entry.content.substr(0, kMaxQuoted) + "..." : entry.content;
+            return entry.sender_name + " (" + when + " ago): " + content;
+        }
+
+        // Returns false for a malformed command.
+        bool HandleHistoryCommand(BotState& state, const ChatCommand& command, const ReplyTarget& target)
+        {
+            constexpr size_t kMaxResults = 3;
+            const std::string& prefix = state.chat_handler.GetPrefix();
+            if (command.name == "last")
+            {
+                if (command.args.size() != 1)
+                {
+                    SendFeedback(state, "Malformed command. Usage: " + prefix + " last <player>.", target);
+                    return false;
+                }
+                const std::optional<ChatHistory::Entry> entry = state.history->Last(command.args.front());
+                SendFeedback(state, entry.has_value() ? FormatHistoryEntry(entry.value())
+                    : "No recent chat from " + command.args.front() + ".", target);
+                return true;
+            }
+
+            if (command.args.empty())
+            {
+                SendFeedback(state, "Malformed command. Usage: " + prefix + " search <terms> [player].", target);
+                return false;
+            }
+
+            // A trailing argument naming someone in the history filters by sender.
+            std::vector<std::string> terms = command.args;
+            std::string player;
+            if (terms.size() > 1 && state.history->HasSender(terms.back()))
+            {
+                player = terms.back();
+                terms.pop_back();
+            }
+
+            const std::vector<ChatHistory::Entry> results = state.history->Search(terms, player, kMaxResults);
+            if (results.empty())
+            {
+                SendFeedback(state, "No matching chat in the last " + std::to_string(state.history->GetSize()) + " messages.", target);
+                return true;
+            }
+            for (const ChatHistory::Entry& entry : results)
+            {
+                SendFeedback(state, FormatHistoryEntry(entry), target);
+            }
+            return true;
+        }
+
+        bool IsPrivileged(const BotState& state, const ChatCommand& command)
+        {
+            if (command.name == "allow" || command.name == "deny")
+            {
+                return true;
+            }
+            if (command.name == "triggers" || command.name == "prof" || command.name == "plugins")
+            {
+                return !command.args.empty();
+            }
+            return state.plugins.Find(command.name) != nullptr;
+        }
+
+        // Appends the command to the audit log when its handler finishes, with
+        // whatever result the handler settled on. A control request that has
+        // not been answered yet reports the same result.
+        struct AuditRecord
+        {
+            BotState& state;
+            audit::Entry entry;
+            std::shared_ptr<ControlRequest> request;
+            bool enabled = false;
+
+            AuditRecord(BotState& owner, const ChatParseResult& parsed, const ReplyTarget& target, const std::optional<ChatMessage>& message)
+                : state(owner), request(target.request)
+            {
+                if (!state.audit)
+                {
+                    return;
+                }
+
+                enabled = target.kind != ReplyTarget::Kind::Chat || IsPrivileged(state, parsed.command);
+                for (const ChatCommand& command : parsed.batch)
+                {
+                    enabled = enabled || IsPrivileged(state, command);
+                }
+                if (!enabled)
+                {
+                    return;
+                }
+
+                switch (target.kind)
+                {
+                case ReplyTarget::Kind::Chat:
+                    entry.source = audit::Source::Chat;
+                    break;
+                case ReplyTarget::Kind::Console:
+                    entry.source = audit::Source::Console;
+                    break;
+                case ReplyTarget::Kind::Control:
+                    entry.source = audit::Source::Control;
+                    break;
+                }
+                entry.player = audit::GetName(entry.source);
+                if (message.has_value())
+                {
+                    entry.sender = message->sender;
+                    entry.player = message->sender_name;
+                    entry.signature = !message->has_signature ? audit::Signature::Missing
+                        : !state.signature_verifier ? audit::Signature::Unchecked
+                        : message->signature_verified ? audit::Signature::Verified
+                        : audit::Signature::Invalid;
+                }
+
+                const std::vector<ChatCommand> single{ parsed.command };
+                for (const ChatCommand& command : parsed.batch.empty() ? single : parsed.batch)
+                {
+                    entry.command += entry.command.empty() ? "" : "; ";
+                    entry.command += command.name;
+                    for (const std::string& arg : command.args)
+                    {
+                        entry.command += ' ' + arg;
+                    }
+                }
+            }
+
+            AuditRecord(AuditRecord&& other) noexcept
+                : state(other.state), entry(std::move(other.entry)), request(std::move(other.request)), enabled(other.enabled)
+            {
+                other.enabled = false;
+            }
+
+            ~AuditRecord()
+            {
+                if (state.scheduler.IsCancelling())
+                {
+                    entry.result = audit::Result::Cancelled;
+                }
+                if (request && !request->completed)
+                {
+                    request->ok = entry.result == audit::Result::Ok;
+                }
+                Flush();
+            }
+
+            // Writes the record now, for handlers that go on to wait.
+            void Flush()
+            {
+                if (enabled)
+                {
+                    enabled = false;
+                    state.audit->Append(std::move(entry));
+                }
+            }
+        };
+
+        std::string FormatAuditEntry(const audit::Entry& entry)
+        {
+            const std::time_t seconds = static_cast<std::time_t>(entry.time_ms / 1000);
+            std::tm utc{};
+            gmtime_r(&seconds, &utc);
+            char when[32];
+            std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &utc);
+            return std::string(when) + " " + entry.player + " (" + audit::GetName(entry.source) + ", signature "
+                + audit::GetName(entry.signature) + "): " + entry.command + " -> " + audit::GetName(entry.result);
+        }
+
+        // Everything a handler needs, moved into its coroutine frame.
+        struct CommandContext
+        {
+            BotState& state;
+            ChatCommand command;
+            ReplyTarget target;
+            std::optional<ChatMessage> message;
+            AuditRecord record;
+
+            void Reply(const std::string& text) const
+            {
+                SendFeedback(state, text, target);
+            }
+
+            void Fail(const std::string& text)
+            {
+                record.entry.result = audit::Result::Failed;
+                Reply(text);
+            }
+
+            std::string Usage(const std::string& syntax) const
+            {
+                return "Malformed command. Usage: " + state.chat_handler.GetPrefix() + " " + syntax + ".";
+            }
+        };
+
+        CommandTask RunAllowlistCommand(CommandContext context)
+        {
+            const AllowlistResult result = ApplyAllowlistCommand(context.state.whitelist, context.command, context.state.chat_handler.GetPrefix());
+            context.record.entry.result = result.ok ? audit::Result::Ok : audit::Result::Failed;
+            context.Reply(result.reply);
+            if (result.changed)
+            {
+                PersistWhitelist(context.state);
+            }
+            co_return;
+        }
+
+        CommandTask RunHistoryCommand(CommandContext context)
+        {
+            if (!HandleHistoryCommand(context.state, context.command, context.target))
+            {
+                context.record.entry.result = audit::Result::Failed;
+            }
+            co_return;
+        }
+
+        CommandTask RunProfCommand(CommandContext context)
+        {
+            const std::vector<std::string>& args = context.command.args;
+            if (args.size() == 1 && args.front() == "reset")
+            {
+                Profiler::Reset();
+                context.Reply("Profile counters reset.");
+                co_return;
+            }
+            if (!args.empty())
+            {
+                context.Fail(context.Usage("prof [reset]"));
+                co_return;
+            }
+
+            // In-game replies are kept to the heaviest few stages.
+            const std::string report = Profiler::FormatReport(context.target.kind == ReplyTarget::Kind::Chat ? 5 : 0);
+            size_t start = 0;
+            while (start <= report.size())
+            {
+                const size_t end = std::min(report.find('\n', start), report.size());
+                context.Reply(report.substr(start, end - start));
+                start = end + 1;
+            }
+        }
+
+        CommandTask RunTriggersCommand(CommandContext context)
+        {
+            BotState& state = context.state;
+            const std::vector<std::string>& args = context.command.args;
+            if (args.empty())
+            {
+                context.Reply(state.triggers.Describe());
+                co_return;
+            }
+            if (args.size() != 1 || args.front() != "reload")
+            {
+                context.Fail(context.Usage("triggers [reload]"));
+                co_return;
+            }
+
+            // Parsing and compiling the automaton happen off the tick thread;
+            // the staged set is swapped in at the start of a tick.
+            std::future<std::string> load = std::async(std::launch::async, [&triggers = state.triggers, path = state.triggers_path]() {
+                std::string error;
+                if (!triggers.LoadFromFile(path, &error) && error.empty())
+                {
+                    error = "Unknown error.";
+                }
+                return error;
+            });
+            while (load.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                co_await state.scheduler.NextTick();
+            }
+            const std::string error = load.get();
+            if (!error.empty())
+            {
+                context.Fail("Trigger reload failed, keeping previous triggers: " + error);
+                co_return;
+            }
+            while (state.triggers.HasStaged())
+            {
+                co_await state.scheduler.NextTick();
+            }
+            context.Reply("Triggers reloaded: " + state.triggers.Describe());
+        }
+
+        CommandTask RunAuditCommand(CommandContext context)
+        {
+            BotState& state = context.state;
+            const std::vector<std::string>& args = context.command.args;
+            if (!state.audit)
+            {
+                context.Fail("Audit log is disabled, start with --audit <path>.");
+                co_return;
+            }
+            if (args.size() > 1)
+            {
+                context.Fail(context.Usage("audit [player]"));
+                co_return;
+            }
+
+            // The scan runs on the audit thread, the handler checks back every
+            // tick instead of blocking this one on disk reads.
+            const std::string player = args.empty() ? "" : args.front();
+            std::future<audit::QueryResult> query = state.audit->QueryRecent(player, 20);
+            while (query.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                co_await state.scheduler.NextTick();
+            }
+            const audit::QueryResult result = query.get();
+            const std::vector<audit::Entry>& entries = result.entries;
+            if (!result.error.empty())
+            {
+                context.Fail("Audit query failed: " + result.error);
+                co_return;
+            }
+            if (entries.empty())
+            {
+                context.Reply(player.empty() ? "No audit entries." : "No recent audit entries for " + player + ".");
+                co_return;
+            }
+            if (context.target.kind != ReplyTarget::Kind::Chat)
+            {
+                for (const audit::Entry& entry : entries)
+                {
+                    context.Reply(FormatAuditEntry(entry));
+                }
+                co_return;
+            }
+
+            // In-game replies come five at a time, the sender asks for more.
+            constexpr size_t kPage = 5;
+            context.record.Flush();
+            for (size_t shown = 0; shown < entries.size();)
+            {
+                const size_t page_end = std::min(shown + kPage, entries.size());
+                for (; shown < page_end; ++shown)
+                {
+                    context.Reply(FormatAuditEntry(entries[shown]));
+                }
+                if (shown == entries.size())
+                {
+                    break;
+                }
+                context.Reply("Reply \"more\" within 30s for older entries.");
+                if (!co_await state.scheduler.NextChat(context.message->sender, "more", std::chrono::seconds(30)))
+                {
+                    break;
+                }
+            }
+        }
+
+        CommandTask RunPluginsCommand(CommandContext context)
+        {
+            BotState& state = context.state;
+            const std::vector<std::string>& args = context.command.args;
+            if (args.empty())
+            {
+                context.Reply(state.plugins.Describe());
+                co_return;
+            }
+            if (args.size() != 1 || args.front() != "reload")
+            {
+                context.Fail(context.Usage("plugins [reload]"));
+                co_return;
+            }
+            if (state.plugins_path.empty())
+            {
+                context.Fail("No plugin directory configured, start with --plugins <dir>.");
+                co_return;
+            }
+
+            std::string error;
+            if (!state.plugins.LoadDirectory(state.plugins_path, ChatWhitelist::IsBuiltinCommand, &error))
+            {
+                context.Fail("Plugin reload failed, keeping current plugins: " + error);
+                co_return;
+            }
+            // The staged table is swapped in at the start of a tick.
+            while (state.plugins.HasStaged())
+            {
+                co_await state.scheduler.NextTick();
+            }
+            context.Reply("Plugins reloaded: " + state.plugins.Describe());
+        }
+
+        CommandTask RunRemindCommand(CommandContext context)
+        {
+            const std::vector<std::string>& args = context.command.args;
+            const std::optional<int> seconds = args.size() < 2 ? std::nullopt : ParseSeconds(args.front());
+            if (!seconds.has_value())
+            {
+                context.Fail(context.Usage("remind <seconds> <text>"));
+                co_return;
+            }
+
+            std::string text;
+            for (size_t i = 1; i < args.size(); ++i)
+            {
+                if (i > 1)
+                {
+                    text += ' ';
+                }
+                text += args[i];
+            }
+
+            context.Reply("Reminder set for " + std::to_string(seconds.value()) + "s.");
+            co_await context.state.scheduler.SleepFor(std::chrono::seconds(seconds.value()));
+            context.Reply("Reminder: " + text);
+        }
+
+        CommandTask RunPluginCommand(CommandContext context)
+        {
+            const std::shared_ptr<const PluginHost::Command> plugin_command = context.state.plugins.Find(context.command.name);
+            if (!plugin_command)
+            {
+                co_return;
+            }
+            if (!context.command.id.has_value())
+            {
+                context.Fail("Command \"" + context.command.name + "\" is disabled: no permission slot left.");
+                co_return;
+            }
+            const bool ok = PluginHost::Invoke(*plugin_command, context.command.args, [&context](std::string_view text) {
+                context.Reply(std::string(text));
+            });
+            if (!ok)
+            {
+                context.Fail("Command \"" + context.command.name + "\" failed.");
+            }
+        }
+
+        // help, ping, echo and unknown names, answered by the chat handler.
+        CommandTask RunBuiltinCommand(CommandContext context)
+        {
+            const ChatCommand& command = context.command;
+            if (!ChatWhitelist::IsBuiltinCommand(command.name) || (command.name == "echo" && command.args.empty()))
+            {
+                context.record.entry.result = audit::Result::Failed;
+            }
+            for (const std::string& response : context.state.chat_handler.HandleCommand(command))
+            {
+                context.Reply(response);
+            }
+            co_return;
+        }
+
+        std::vector<CommandHandler> BuildCommandHandlers(const ChatWhitelist& whitelist)
+        {
+            const std::pair<const char*, CommandHandler> handlers[] = {
+                { "allow", RunAllowlistCommand },
+                { "deny", RunAllowlistCommand },
+                { "list", RunAllowlistCommand },
+                { "search", RunHistoryCommand },
+                { "last", RunHistoryCommand },
+                { "prof", RunProfCommand },
+                { "triggers", RunTriggersCommand },
+                { "audit", RunAuditCommand },
+                { "plugins", RunPluginsCommand },
+                { "remind", RunRemindCommand }
+            };
+
+            std::vector<CommandHandler> table;
+            for (const auto& [name, handler] : handlers)
+            {
+                const std::optional<std::size_t> id = whitelist.FindCommand(name);
+                if (!id.has_value())
+                {
+                    continue;
+                }
+                if (table.size() <= id.value())
+                {
+                    table.resize(id.value() + 1, nullptr);
+                }
+                table[id.value()] = handler;
+            }
+            return table;
+        }
+
+        CommandHandler FindCommandHandler(const BotState& state, const ChatCommand& command)
+        {
+            if (command.id.has_value() && command.id.value() < state.command_handlers.size()
+                && state.command_handlers[command.id.value()] != nullptr)
+            {
+                return state.command_handlers[command.id.value()];
+            }
+            if (state.plugins.Find(command.name) != nullptr)
+            {
+                return RunPluginCommand;
+            }
+            return RunBuiltinCommand;
+        }
+
+        // Checks the sender and hands the command to its handler, which runs
+        // inside Spawn until it first waits.
+        void RunCommand(BotState& state,
+            ChatParseResult parsed,
+            ReplyTarget target,
+            std::optional<ChatMessage> message)
+        {
+            if (!parsed.is_command)
+            {
+                return;
+            }
+
+            if (!state.startup.command_reported.exchange(true))
+            {
+                const double seconds = (Tracer::Now() - state.startup.start_ns) / 1e9;
+                Metrics::GetInstance().Set("absinthe_startup_first_command_seconds", seconds);
+                LOG_INFO("First command handled " << seconds * 1000.0 << " ms after start");
+            }
+
+            if (!parsed.ok)
+            {
+                SendFeedback(state, parsed.error, target);
+                return;
+            }
+
+            AuditRecord audit_record(state, parsed, target, message);
+            if (target.kind == ReplyTarget::Kind::Chat)
+            {
+                if (!message.has_value() || !message->has_signature)
+                {
+                    audit_record.entry.result = audit::Result::Denied;
+                    SendFeedback(state, "Secure chat signature missing. Commands require signed chat.", target);
+                    return;
+                }
+
+                if (state.signature_verifier && !message->signature_verified)
+                {
+                    audit_record.entry.result = audit::Result::Denied;
+                    SendFeedback(state, "Secure chat signature could not be verified.", target);
+                    return;
+                }
+
+                std::uint64_t permissions = 0;
+                {
+                    ABSINTHE_TRACE_SPAN("is allowed");
+                    permissions = state.whitelist.GetPermissions(*message);
+                }
+                if (permissions == 0)
+                {
+                    audit_record.entry.result = audit::Result::Denied;
+                    SendFeedback(state, "You are not authorized to issue commands.", target);
+                    return;
+                }
+
+                const ChatCommand* denied = ChatWhitelist::Permits(permissions, parsed.command.id) ? nullptr : &parsed.command;
+                for (const ChatCommand& command : parsed.batch)
+                {
+                    if (!denied && !ChatWhitelist::Permits(permissions, command.id))
+                    {
+                        denied = &command;
+                    }
+                }
+                if (denied)
+                {
+                    audit_record.entry.result = audit::Result::Denied;
+                    SendFeedback(state, "Your role does not allow \"" + denied->name + "\".", target);
+                    return;
+                }
+            }
+
+            // The profiler keeps a row per detail, so only names that resolved
+            // to a command id get one of their own. The span ends when the
+            // handler first waits.
+            const std::string command_detail = !parsed.batch.empty() ? "batch"
+                : parsed.command.id.has_value() ? parsed.command.name
+                : "unknown";
+            TraceSpan command_span("command", command_detail.c_str());
+
+            if (!parsed.batch.empty())
+            {
+                if (!RunBatch(state, parsed.batch, target))
+                {
+                    audit_record.entry.result = audit::Result::Failed;
+                }
+                return;
+            }
+
+            const CommandHandler handler = FindCommandHandler(state, parsed.command);
+            state.scheduler.Spawn(handler(CommandContext{ state, std::move(parsed.command), std::move(target), std::move(message),
+                std::move(audit_record) }));
+        }
+
+        ChatParseResult ParseConsole(const ChatHandler& chat_handler, const std::string& line)
+        {
+            std::string trimmed = Trim(line);
+            if (trimmed.empty())
+            {
+                return ChatParseResult{};
+            }
+
+            if (trimmed.rfind(chat_handler.GetPrefix(), 0) != 0)
+            {
+                trimmed = chat_handler.GetPrefix() + " " + trimmed;
+            }
+
+            ABSINTHE_TRACE_SPAN("parse");
+            return chat_handler.Parse(trimmed);
+        }
+
+        void ScanTriggers(BotState& state, const ChatMessage& message)
+        {
+            if (state.triggers.IsEmpty())
+            {
+                return;
+            }
+
+            ABSINTHE_TRACE_SPAN("triggers");
+            for (const ChatTriggers::Hit& hit : state.triggers.Match(message.content))
+            {
+                if (hit.cooling_down)
+                {
+                    continue;
+                }
+
+                if (hit.trigger->action == TriggerAction::Alert)
+                {
+                    LOG_WARNING("Trigger \"" << hit.trigger->pattern << "\" matched chat from "
+                        << message.sender_name << ": " << message.content);
+                }
+                else
+                {
+                    SendFeedback(state, hit.trigger->reply, ReplyTarget{});
+                }
+            }
+        }
+
+        void DispatchChatMessage(BotState& state, ChatMessage message)
+        {
+            ABSINTHE_TRACE_SPAN("dispatch");
+            if (message.received_ns != 0 && Tracer::IsEnabled())
+            {
+                Tracer::Record("queue wait", message.received_ns, Tracer::Now());
+            }
+
+            // A reply trigger matching its own reply would otherwise loop.
+            if (std::find(state.own_uuids.begin(), state.own_uuids.end(), message.sender) != state.own_uuids.end())
+            {
+                return;
+            }
+
+            if (state.scheduler.DispatchChat(message))
+            {
+                return;
+            }
+
+            ChatParseResult parsed;
+            {
+                ABSINTHE_TRACE_SPAN("parse");
+                parsed = state.chat_handler.Parse(message.content);
+            }
+            if (!parsed.is_command)
+            {
+                ScanTriggers(state, message);
+                state.history->Record(message);
+                return;
+            }
+            state.watchdog.SetActivity("chat handler: command " + parsed.command.name + " from " + message.sender_name);
+            RunCommand(state, std::move(parsed), ReplyTarget{}, std::move(message));
+        }
+
+        void TakeOver(ChatEndpoint& client, BotState& state)
+        {
+            const std::uint64_t start = Tracer::Now();
+            state.active = &client;
+
+            std::deque<ChatMessage> backlog;
+            backlog.swap(state.standby_backlog);
+            size_t replayed = 0;
+            for (ChatMessage& message : backlog)
+            {
+                if (message.received_ns > state.last_dispatch_ns)
+                {
+                    DispatchChatMessage(state, std::move(message));
+                    ++replayed;
+                }
+            }
+            FlushOutbound(client, state);
+
+            const double seconds = (Tracer::Now() - start) / 1e9;
+            Metrics::GetInstance().Set("absinthe_failover_seconds", seconds);
+            Metrics::GetInstance().Add("absinthe_failovers_total", 1);
+            LOG_WARNING("Primary connection lost, standby took over command handling in " << seconds * 1000.0
+                << " ms (" << replayed << " buffered messages replayed, " << state.outbound.size() << " replies pending)");
+        }
+
+        // Called once a client's connection has closed and its verifier has
+        // been reset, before the client is destroyed. If it was active, the
+        // other login takes over or its undispatched chat is handled here, and
+        // replies wait in outbound for the next connection.
+        void RetireEndpoint(ChatEndpoint& client, BotState& state)
+        {
+            // A connection that closed before reaching play never waited for
+            // the allowlist and triggers the dispatch below relies on.
+            WaitForConfig(state);
+            std::lock_guard<std::mutex> lock(state.dispatch_mutex);
+            ChatEndpoint* peer = state.primary == &client ? state.standby : state.primary;
+            if (state.primary == &client)
+            {
+                state.primary = nullptr;
+            }
+            if (state.standby == &client)
+            {
+                state.standby = nullptr;
+            }
+            if (state.active != &client)
+            {
+                return;
+            }
+            if (peer != nullptr && peer->IsConnected())
+            {
+                TakeOver(*peer, state);
+                return;
+            }
+
+            ChatMessage message;
+            while (client.PopChatMessage(message))
+            {
+                DispatchChatMessage(state, std::move(message));
+            }
+            state.last_dispatch_ns = Tracer::Now();
+            state.active = nullptr;
+            // Only the active client ticks, and nothing does until the next
+            // connection reaches play. A standby retiring while the other
+            // client is active leaves the watchdog on that one.
+            state.watchdog.Pause();
+        }
+
+        // Plugin reloads only stage a new table; it goes live here, before the
+        // tick dispatches anything. Plugin commands get a permission bit so
+        // roles can grant them, and give it back when a reload drops them.
+        void CommitPlugins(BotState& state)
+        {
+            const std::vector<std::string> previous = state.plugins.GetCommandNames();
+            if (!state.plugins.Commit())
+            {
+                return;
+            }
+            const std::vector<std::string> current = state.plugins.GetCommandNames();
+            for (const std::string& name : previous)
+            {
+                if (!std::binary_search(current.begin(), current.end(), name))
+                {
+                    state.whitelist.UnregisterCommand(name);
+                }
+            }
+            for (const std::string& name : current)
+            {
+                if (!state.whitelist.FindCommand(name) && !state.whitelist.RegisterCommand(name))
+                {
+                    LOG_WARNING("No permission slot left for plugin command \"" << name << "\", it stays disabled");
+                }
+            }
+            LOG_INFO("Plugins active: " << state.plugins.Describe());
+        }
+
+        void ProcessChatTick(ChatEndpoint& client, BotState& state)
+        {
+            std::lock_guard<std::mutex> lock(state.dispatch_mutex);
+            if (state.active == nullptr)
+            {
+                state.active = &client;
+            }
+            if (state.active != &client)
+            {
+                if (state.active->IsConnected() || !client.IsConnected())
+                {
+                    BufferStandbyChat(client, state);
+                    return;
+                }
+                TakeOver(client, state);
+            }
+
+            state.watchdog.BeginTick();
+            CommitPlugins(state);
+            if (state.triggers.Commit())
+            {
+                LOG_INFO("Triggers active: " << state.triggers.Describe());
+            }
+            state.watchdog.SetActivity("chat handler: chat");
+            ChatMessage message;
+            while (client.PopChatMessage(message))
+            {
+                DispatchChatMessage(state, std::move(message));
+            }
+            state.last_dispatch_ns = Tracer::Now();
+
+            std::deque<std::string> pending;
+            {
+                std::lock_guard<std::mutex> lock(state.stdin_queue->mutex);
+                pending.swap(state.stdin_queue->lines);
+            }
+
+            for (const auto& line : pending)
+            {
+                ChatParseResult parsed = ParseConsole(state.chat_handler, line);
+                if (!parsed.is_command)
+                {
+                    continue;
+                }
+                state.watchdog.SetActivity("chat handler: console command " + parsed.command.name);
+                RunCommand(state, std::move(parsed), ReplyTarget{ ReplyTarget::Kind::Console, nullptr }, std::nullopt);
+            }
+
+            if (state.control)
+            {
+                state.watchdog.SetActivity("chat handler: control socket");
+                state.control->Poll([&state](const std::shared_ptr<ControlRequest>& request, const std::string& line) {
+                    ChatParseResult parsed = ParseConsole(state.chat_handler, line);
+                    if (!parsed.is_command)
+                    {
+                        request->ok = false;
+                        request->replies.push_back("Empty command.");
+                        return;
+                    }
+                    // Malformed here; otherwise RunCommand reports the outcome.
+                    request->ok = parsed.ok;
+                    RunCommand(state, std::move(parsed), ReplyTarget{ ReplyTarget::Kind::Control, request }, std::nullopt);
+                    state.control->Complete(*request);
+                });
+            }
+
+            state.watchdog.SetActivity("chat handler: resume suspended commands");
+            state.scheduler.Tick();
+            FlushOutbound(client, state);
+            if (state.whitelist_dirty)
+            {
+                state.watchdog.SetActivity("chat handler: save allowlist");
+                state.whitelist_dirty = false;
+                PersistWhitelist(state);
+            }
+            state.watchdog.SetActivity("idle");
+            state.watchdog.EndTick();
+        }
+
+        Botcraft::Status HandleChatLoop(ChatBehaviourClient& client, BotState& state)
+        {
+            ProcessChatTick(client, state);
+            client.Yield();
+            return Botcraft::Status::Failure;
+        }
+
+        void LogResourceUsage(const char* mode)
+        {
+            if (Profiler::IsCompiled())
+            {
+                LOG_INFO("Per-stage profile:\n" << Profiler::FormatReport());
+            }
+            rusage usage{};
+            if (getrusage(RUSAGE_SELF, &usage) != 0)
+            {
+                return;
+            }
+            const double user_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+            const double system_seconds = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+            LOG_INFO("Resource usage (" << mode << "): peak RSS " << usage.ru_maxrss / 1024 << " MiB, CPU "
+                << user_seconds << "s user / " << system_seconds << "s system");
+        }
+
+        void RunChatOnlySession(const Args& args, BotState& state, ReconnectBackoff& backoff)
+        {
+            ChatOnlyClient client;
+            client.SetSignatureVerifier(state.signature_verifier.get());
+            client.SetArchive(state.archive.get());
+            LOG_INFO("Starting connection process (chat-only)");
+            BeginConnectAttempt(state.startup);
+            ThreadLayout::GetInstance().RunInRole(ThreadRole::Network, "network", [&]() {
+                client.Connect(args.address, args.login);
+            });
+            if (!state.startup.play_reported)
+            {
+                MarkPhase(state.startup, "connect");
+            }
+
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(15000);
+            while (!client.GetShouldBeClosed())
+            {
+                const auto manager = client.GetNetworkManager();
+                if (manager && manager->GetConnectionState() == ProtocolCraft::ConnectionState::Play)
+                {
+                    RememberOwnUUID(state, client);
+                    MarkConnected(state);
+                    backoff.play_since_ns.store(Tracer::Now());
+                    break;
+                }
+                if (std::chrono::steady_clock::now() >= deadline)
+                {
+                    LOG_ERROR("Timeout waiting for Play state");
+                    client.SetShouldBeClosed(true);
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            LOG_INFO(ThreadLayout::GetInstance().FormatReport());
+
+            while (!client.GetShouldBeClosed())
+            {
+                ProcessChatTick(client, state);
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+
+            client.Disconnect();
+            if (state.signature_verifier)
+            {
+                state.signature_verifier->ResetConnection();
+            }
+            RetireEndpoint(client, state);
+        }
+
+        int RunChatOnly(const Args& args, BotState& state)
+        {
+            Tracer::SetThreadName("chat loop");
+            ThreadLayout::GetInstance().ApplyToCurrentThread(ThreadRole::Behaviour, "absinthe");
+            ReconnectBackoff backoff{ std::chrono::seconds(args.reconnect_max_seconds) };
+            do
+            {
+                RunChatOnlySession(args, state, backoff);
+            } while (WaitBeforeReconnect(args, state, backoff));
+
+            state.watchdog.Stop();
+            if (state.signature_verifier)
+            {
+                state.signature_verifier->Stop();
+            }
+            if (state.archive)
+            {
+                state.archive->Close();
+            }
+            state.scheduler.CancelAll();
+            if (state.audit)
+            {
+                state.audit->Close();
+            }
+            LogResourceUsage("chat-only");
+            return 0;
+        }
+
+        // Every connection gets a fresh tree, so a reconnect starts over at
+        // AwaitPlayState.
+        auto BuildBehaviourTree(BotState& state, ReconnectBackoff& backoff)
         {
             return Botcraft::Builder<ChatBehaviourClient>("startup")
                 .sequence()
-                    .leaf("await play state", AwaitPlayState)
+                    .leaf("await play state", [&state, &backoff](ChatBehaviourClient& client) {
+                        const Botcraft::Status status = AwaitPlayState(client);
+                        if (status == Botcraft::Status::Success)
+                        {
+                            RememberOwnUUID(state, client);
+                            if (backoff.track_recovery)
+                            {
+                                MarkConnected(state);
+                            }
+                            else
+                            {
+                                WaitForConfig(state);
+                            }
+                            backoff.play_since_ns.store(Tracer::Now());
+                        }
+                        return status;
+                    })
                     .repeater("chat loop", 0)
                         .leaf("chat handler", [&](ChatBehaviourClient& client) {
-                            return HandleChatLoop(client, chat_handler, whitelist, whitelist_path, stdin_queue);
+                            return HandleChatLoop(client, state);
                         })
                     .end();
         }
+
+        bool IsClosing(BotState& state)
+        {
+            std::lock_guard<std::mutex> lock(state.dispatch_mutex);
+            return state.closing;
+        }
+
+        // The standby's own connect loop, on its own thread. It retires
+        // through the same path as the primary and reconnects with its own
+        // backoff, until reconnecting is disabled.
+        void RunStandby(const Args& args, BotState& state)
+        {
+            ReconnectBackoff backoff{ std::chrono::seconds(args.reconnect_max_seconds), "Standby connection", false };
+            do
+            {
+                ChatBehaviourClient standby(false);
+                standby.SetAutoRespawn(true);
+                standby.SetSignatureVerifier(state.standby_verifier.get());
+                LOG_INFO("Starting standby connection as " << args.standby_login);
+                ThreadLayout::GetInstance().RunInRole(ThreadRole::Network, "standby net", [&]() {
+                    standby.Connect(args.address, args.standby_login);
+                });
+                standby.SetBehaviourTree(BuildBehaviourTree(state, backoff));
+                {
+                    std::lock_guard<std::mutex> lock(state.dispatch_mutex);
+                    if (state.closing)
+                    {
+                        standby.Close();
+                    }
+                    state.standby = &standby;
+                }
+
+                standby.RunBehaviourUntilClosed();
+                standby.Disconnect();
+                if (state.standby_verifier)
+                {
+                    state.standby_verifier->ResetConnection();
+                }
+                RetireEndpoint(standby, state);
+            } while (!IsClosing(state) && WaitBeforeReconnect(args, state, backoff));
+        }
     }
 
     void ShowHelp(const char* argv0)
@@ -350,33 +1907,274 @@ namespace absinthe
             << "\t--address\tAddress of the server you want to connect to, default: 127.0.0.1:25565\n"
             << "\t--login [name]\tPlayer name in offline mode, omit/empty for Microsoft account, default: absinthe\n"
             << "\t--allow <name|uuid>\tAllowlisted player name or UUID (repeatable)\n"
+            << "\t--trace <path>\tRecord Chrome/Perfetto trace spans of the chat pipeline to path\n"
+            << "\t--control <path>\tServe console commands on a Unix-domain socket with one JSON response per line\n"
+            << "\t--thread-cpus <role>=<cpus>\tPin a thread role (network, behaviour, persistence, logging) to CPUs, e.g. network=2-3 (repeatable)\n"
+            << "\t--thread-nice <role>=<n>\tSet the nice value of a thread role (repeatable)\n"
+            << "\t--tick-budget <ms>\tWarn and sample the stack when a chat tick exceeds this, 0 disables, default: 250\n"
+            << "\t--audit <path>\tRecord privileged and console commands in a checksummed binary audit log, query it with the audit command\n"
+            << "\t--plugins <dir>\tLoad command plugins (*.so) from dir, reload them in place with the plugins command\n"
+            << "\t--reconnect-max <s>\tReconnect with jittered exponential backoff capped at this delay, 0 exits on disconnect instead, default: 60\n"
+            << "\t--archive <path>\tAppend all received chat to a block-compressed archive, read it back with absinthe_archive\n"
+            << "\t--metrics-file <path>\tPeriodically write metrics in Prometheus textfile format to path\n"
+            << "\t--history <n>\tNumber of recent chat messages kept for search/last, default: 4096\n"
+            << "\t--history-bytes <n>\tArena size for chat history content, default: 1048576\n"
+            << "\t--verify-signatures\tVerify chat signatures of commands against the sender's profile key as relayed by the server; the key's Mojang signature is not checked, so this trusts the server\n"
+            << "\t--verify-threads <n>\tWorker threads for signature verification, default: 2\n"
+            << "\t--standby-login <name>\tKeep a second, passive login connected to take over if the primary drops\n"
+            << "\t--chat-only\tSkip world, entity and inventory tracking, only handle chat\n"
             << std::endl;
     }
 
     int Application::Run(int argc, char* argv[])
     {
+        const std::uint64_t start_ns = Tracer::Now();
         Args args = ParseCommandLine(argc, argv);
         if (args.return_code != 0)
         {
             return args.return_code;
         }
 
-        ChatHandler chat_handler;
-        ChatWhitelist whitelist;
-        const std::string whitelist_path = "whitelist.yaml";
-        LoadWhitelist(whitelist, whitelist_path, args.allow_list);
+        for (const std::string& spec : args.thread_cpus)
+        {
+            std::string error;
+            if (!ThreadLayout::GetInstance().SetCpus(spec, &error))
+            {
+                LOG_FATAL("--thread-cpus: " << error);
+                return 1;
+            }
+        }
+        for (const std::string& spec : args.thread_nice)
+        {
+            std::string error;
+            if (!ThreadLayout::GetInstance().SetNice(spec, &error))
+            {
+                LOG_FATAL("--thread-nice: " << error);
+                return 1;
+            }
+        }
+
+        if (!args.trace_path.empty())
+        {
+            std::string error;
+            if (!Tracer::Start(args.trace_path, &error))
+            {
+                LOG_ERROR(error);
+            }
+            else
+            {
+                LOG_INFO("Recording trace to " << args.trace_path);
+            }
+        }
+        struct TraceStopper
+        {
+            ~TraceStopper()
+            {
+                Tracer::Stop();
+            }
+        } trace_stopper;
+
+        if (args.chat_only && !args.standby_login.empty())
+        {
+            LOG_FATAL("--standby-login is not supported with --chat-only");
+            return 1;
+        }
+
+        BotState state;
+        state.chat_handler.SetCommandResolver([&state](const std::string& name) {
+            return state.whitelist.FindCommand(name);
+        });
+        state.command_handlers = BuildCommandHandlers(state.whitelist);
+        state.startup.start_ns = start_ns;
+        state.startup.last_ns = start_ns;
+        MarkPhase(state.startup, "arguments");
+        if (args.verify_signatures)
+        {
+            if (!ChatSignatureVerifier::IsSupported())
+            {
+                LOG_FATAL("--verify-signatures requires Botcraft built with encryption and protocol > 1.19.2");
+                return 1;
+            }
+            state.signature_verifier = std::make_unique<ChatSignatureVerifier>(state.chat_handler.GetPrefix(),
+                static_cast<size_t>(args.verify_threads));
+            LOG_WARNING("Verifying command signatures against profile keys relayed by the server. The keys' Mojang signatures "
+                "are not checked, so this guards against tampering below the server, not against the server itself.");
+            if (!args.standby_login.empty())
+            {
+                // The last-seen signature cache is per connection, so the standby needs its own.
+                state.standby_verifier = std::make_unique<ChatSignatureVerifier>(state.chat_handler.GetPrefix(),
+                    static_cast<size_t>(args.verify_threads));
+            }
+        }
+        state.plugins_path = args.plugins_path;
+        state.history = std::make_unique<ChatHistory>(static_cast<size_t>(args.history_size), static_cast<size_t>(args.history_bytes));
+
+        if (!args.archive_path.empty())
+        {
+            state.archive = std::make_unique<ChatArchive>();
+            std::string error;
+            if (!state.archive->Open(args.archive_path, &error))
+            {
+                LOG_FATAL(error);
+                return 1;
+            }
+            LOG_INFO("Archiving chat to " << args.archive_path);
+        }
+
+        if (!args.audit_path.empty())
+        {
+            state.audit = std::make_unique<AuditLog>();
+            std::string error;
+            if (!state.audit->Open(args.audit_path, &error))
+            {
+                LOG_FATAL(error);
+                return 1;
+            }
+            LOG_INFO("Auditing privileged commands to " << args.audit_path);
+        }
+
+        if (!args.control_path.empty())
+        {
+            state.control = std::make_unique<ControlSocket>();
+            std::string error;
+            if (!state.control->Open(args.control_path, &error))
+            {
+                LOG_FATAL(error);
+                return 1;
+            }
+            LOG_INFO("Accepting control commands on " << args.control_path);
+        }
+
+        state.stdin_queue = StartStdinReader();
+        if (!args.metrics_path.empty())
+        {
+            Metrics::GetInstance().StartExport(args.metrics_path, std::chrono::milliseconds(5000));
+        }
+        struct MetricsStopper
+        {
+            ~MetricsStopper()
+            {
+                Metrics::GetInstance().StopExport();
+            }
+        } metrics_stopper;
+        state.watchdog.Start(std::chrono::milliseconds(args.tick_budget_ms));
+        MarkPhase(state.startup, "setup");
+
+        state.config_loaded = std::async(std::launch::async, [&state, &args]() {
+            ABSINTHE_TRACE_SPAN("load config");
+            const std::uint64_t begin = Tracer::Now();
+            state.whitelist_dirty = LoadWhitelist(state.whitelist, state.whitelist_path, args.allow_list);
+            LoadTriggers(state.triggers, state.triggers_path);
+            if (!state.plugins_path.empty())
+            {
+                std::string error;
+                if (!state.plugins.LoadDirectory(state.plugins_path, ChatWhitelist::IsBuiltinCommand, &error))
+                {
+                    LOG_ERROR(error);
+                }
+            }
+            RecordPhase(state.startup, "config", Tracer::Now() - begin, true);
+        }).share();
+        struct ConfigFinisher
+        {
+            BotState& state;
+
+            // Covers every exit: an allowlist change from --allow that no
+            // chat tick got to save is written before the process ends.
+            ~ConfigFinisher()
+            {
+                WaitForConfig(state);
+                if (state.whitelist_dirty)
+                {
+                    PersistWhitelist(state);
+                }
+            }
+        } config_finisher{ state };
+
+        if (args.chat_only)
+        {
+            return RunChatOnly(args, state);
+        }
+
+        std::thread standby_thread;
+        ReconnectBackoff backoff{ std::chrono::seconds(args.reconnect_max_seconds) };
+        do
+        {
+            ChatBehaviourClient client(false);
+            client.SetAutoRespawn(true);
+            client.SetSignatureVerifier(state.signature_verifier.get());
+            client.SetArchive(state.archive.get());
+            LOG_INFO("Starting connection process");
+            BeginConnectAttempt(state.startup);
+            ThreadLayout::GetInstance().RunInRole(ThreadRole::Network, "network", [&]() {
+                client.Connect(args.address, args.login);
+            });
+            client.SetBehaviourTree(BuildBehaviourTree(state, backoff));
+            if (!state.startup.play_reported)
+            {
+                MarkPhase(state.startup, "connect");
+            }
+            {
+                // After a reconnect the standby may already be handling
+                // commands; this connection then stays passive until it drops.
+                std::lock_guard<std::mutex> lock(state.dispatch_mutex);
+                state.primary = &client;
+                if (state.active == nullptr)
+                {
+                    state.active = &client;
+                }
+            }
 
-        auto stdin_queue = StartStdinReader();
-        auto behaviour_tree = BuildBehaviourTree(chat_handler, whitelist, whitelist_path, stdin_queue);
+            if (!standby_thread.joinable() && !args.standby_login.empty())
+            {
+                standby_thread = std::thread([&args, &state]() {
+                    Botcraft::Logger::GetInstance().RegisterThread("standby");
+                    RunStandby(args, state);
+                });
+            }
 
-        ChatBehaviourClient client(false);
-        client.SetAutoRespawn(true);
-        LOG_INFO("Starting connection process");
-        client.Connect(args.address, args.login);
-        client.SetBehaviourTree(behaviour_tree);
+            client.RunBehaviourUntilClosed();
+            client.Disconnect();
+            if (state.signature_verifier)
+            {
+                state.signature_verifier->ResetConnection();
+            }
+            RetireEndpoint(client, state);
+        } while (WaitBeforeReconnect(args, state, backoff));
 
-        client.RunBehaviourUntilClosed();
-        client.Disconnect();
+        if (standby_thread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(state.dispatch_mutex);
+                state.closing = true;
+                if (state.standby != nullptr)
+                {
+                    state.standby->Close();
+                }
+            }
+            standby_thread.join();
+        }
+        state.watchdog.Stop();
+        if (state.signature_verifier)
+        {
+            state.signature_verifier->Stop();
+        }
+        if (state.standby_verifier)
+        {
+            state.standby_verifier->Stop();
+        }
+        if (state.archive)
+        {
+            state.archive->Close();
+        }
+        // Handlers still waiting on a timer or a reply are recorded as
+        // cancelled while the audit log can take them.
+        state.scheduler.CancelAll();
+        if (state.audit)
+        {
+            state.audit->Close();
+        }
+        LogResourceUsage("full");
         return 0;
     }
 }
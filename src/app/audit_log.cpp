@@ -0,0 +1,365 @@
+#include "absinthe/audit_log.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "botcraft/Utilities/Logger.hpp"
+#include "absinthe/metrics.hpp"
+#include "absinthe/thread_layout.hpp"
+#include "absinthe/trace.hpp"
+
+namespace absinthe
+{
+    namespace
+    {
+        constexpr auto kFlushInterval = std::chrono::milliseconds(200);
+        constexpr auto kSyncInterval = std::chrono::seconds(1);
+        // ReadRecent gives up after this many records, so a filter that
+        // matches nothing does not read the whole file.
+        constexpr std::size_t kMaxScanRecords = 16384;
+        constexpr std::size_t kReadChunkRecords = 64;
+
+        std::string FormatUuid(const ProtocolCraft::UUID& uuid)
+        {
+            static constexpr char kHex[] = "0123456789abcdef";
+            std::string output;
+            output.reserve(36);
+            for (size_t i = 0; i < uuid.size(); ++i)
+            {
+                if (i == 4 || i == 6 || i == 8 || i == 10)
+                {
+                    output.push_back('-');
+                }
+                output.push_back(kHex[(uuid[i] >> 4) & 0xF]);
+                output.push_back(kHex[uuid[i] & 0xF]);
+            }
+            return output;
+        }
+
+        std::string ToLower(std::string value)
+        {
+            std::transform(value.begin(), value.end(), value.begin(), [](const unsigned char c) {
+                return static_cast<char>(std::tolower(c));
+            });
+            return value;
+        }
+
+        std::int64_t UnixMillis()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    AuditLog::AuditLog(const std::size_t capacity)
+    {
+        std::size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        slots_ = std::make_unique<Slot[]>(size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        mask_ = size - 1;
+    }
+
+    AuditLog::~AuditLog()
+    {
+        Close();
+    }
+
+    bool AuditLog::Open(const std::string& path, std::string* error)
+    {
+        fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+        {
+            if (error)
+            {
+                *error = "Unable to open audit log: " + path + ": " + std::strerror(errno);
+            }
+            return false;
+        }
+
+        struct stat info{};
+        fstat(fd_, &info);
+        const std::size_t header_size = sizeof(audit::kFileMagic);
+        std::size_t size = static_cast<std::size_t>(info.st_size);
+        if (size == 0)
+        {
+            std::vector<unsigned char> header(audit::kFileMagic, audit::kFileMagic + header_size);
+            WriteAll(header);
+            fsync(fd_);
+        }
+        else
+        {
+            char magic[sizeof(audit::kFileMagic)] = {};
+            if (size < header_size || pread(fd_, magic, header_size, 0) != static_cast<ssize_t>(header_size)
+                || std::memcmp(magic, audit::kFileMagic, header_size) != 0)
+            {
+                close(fd_);
+                fd_ = -1;
+                if (error)
+                {
+                    *error = "Not an audit log: " + path;
+                }
+                return false;
+            }
+
+            // A crash mid-write leaves a partial record; drop it so appends
+            // stay aligned.
+            const std::size_t aligned = header_size + audit::CountRecords(size) * audit::kRecordSize;
+            if (aligned != size && ftruncate(fd_, static_cast<off_t>(aligned)) == 0)
+            {
+                LOG_WARNING("Dropped " << size - aligned << " bytes of a torn record at the end of " << path);
+            }
+        }
+
+        stopping_ = false;
+        thread_ = std::thread(&AuditLog::Run, this);
+        return true;
+    }
+
+    void AuditLog::Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+        if (fd_ >= 0)
+        {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    bool AuditLog::Append(audit::Entry entry)
+    {
+        if (fd_ < 0)
+        {
+            Metrics::GetInstance().Add("absinthe_audit_dropped_total", 1);
+            LOG_WARNING("Audit log is closed, dropped the record of \"" << entry.command << "\" by " << entry.player);
+            return false;
+        }
+        entry.time_ms = UnixMillis();
+
+        // Bounded multi-producer ring: a slot is free for position p when its
+        // sequence equals p and holds a record once it equals p + 1.
+        std::size_t position = tail_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot& slot = slots_[position & mask_];
+            const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t lag = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (lag == 0)
+            {
+                if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    audit::Encode(entry, slot.bytes.data());
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (lag < 0)
+            {
+                Metrics::GetInstance().Add("absinthe_audit_dropped_total", 1);
+                return false;
+            }
+            else
+            {
+                position = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void AuditLog::Drain(std::vector<unsigned char>& batch)
+    {
+        while (true)
+        {
+            Slot& slot = slots_[head_ & mask_];
+            if (slot.sequence.load(std::memory_order_acquire) != head_ + 1)
+            {
+                return;
+            }
+            unsigned char* record = slot.bytes.data();
+            audit::Seal(record);
+            batch.insert(batch.end(), record, record + audit::kRecordSize);
+            slot.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+            ++head_;
+        }
+    }
+
+    bool AuditLog::WriteAll(const std::vector<unsigned char>& batch)
+    {
+        // A partial batch would leave a torn record that shifts every later
+        // one off the record grid, so a failed write is cut back to here.
+        struct stat info{};
+        const off_t start = fstat(fd_, &info) == 0 ? info.st_size : -1;
+        std::size_t written = 0;
+        while (written < batch.size())
+        {
+            const ssize_t result = write(fd_, batch.data() + written, batch.size() - written);
+            if (result < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                Metrics::GetInstance().Add("absinthe_audit_write_errors_total", 1);
+                LOG_WARNING("Audit log write failed: " << std::strerror(errno));
+                if (written > 0 && start >= 0 && ftruncate(fd_, start) != 0)
+                {
+                    LOG_ERROR("Unable to drop a partial audit batch: " << std::strerror(errno));
+                }
+                return false;
+            }
+            written += static_cast<std::size_t>(result);
+        }
+        return true;
+    }
+
+    void AuditLog::Run()
+    {
+        Tracer::SetThreadName("audit");
+        ThreadLayout::GetInstance().ApplyToCurrentThread(ThreadRole::Persistence, "audit");
+        std::vector<unsigned char> batch;
+        auto last_sync = std::chrono::steady_clock::now();
+        bool unsynced = false;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(wake_mutex_);
+                wake_.wait_for(lock, kFlushInterval, [this]() { return stopping_.load() || !queries_.empty(); });
+            }
+            const bool stopping = stopping_.load();
+            std::deque<Query> queries;
+            {
+                std::lock_guard<std::mutex> lock(wake_mutex_);
+                queries.swap(queries_);
+            }
+
+            batch.clear();
+            Drain(batch);
+            if (!batch.empty())
+            {
+                ABSINTHE_TRACE_SPAN("audit flush");
+                WriteAll(batch);
+                Metrics::GetInstance().Add("absinthe_audit_records_total", static_cast<double>(batch.size() / audit::kRecordSize));
+                unsynced = true;
+            }
+            Answer(queries);
+
+            const auto now = std::chrono::steady_clock::now();
+            if (unsynced && (stopping || now - last_sync >= kSyncInterval))
+            {
+                fdatasync(fd_);
+                last_sync = now;
+                unsynced = false;
+            }
+            if (stopping)
+            {
+                return;
+            }
+        }
+    }
+
+    std::future<audit::QueryResult> AuditLog::QueryRecent(std::string player, const std::size_t limit)
+    {
+        Query query{ std::move(player), limit, {} };
+        std::future<audit::QueryResult> result = query.result.get_future();
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            if (fd_ >= 0 && !stopping_.load())
+            {
+                queries_.push_back(std::move(query));
+            }
+            else
+            {
+                query.result.set_value(audit::QueryResult{ {}, "Audit log is not open." });
+            }
+        }
+        wake_.notify_one();
+        return result;
+    }
+
+    void AuditLog::Answer(std::deque<Query>& queries) const
+    {
+        for (Query& query : queries)
+        {
+            ABSINTHE_TRACE_SPAN("audit query");
+            audit::QueryResult result;
+            result.entries = ReadRecent(query.player, query.limit, &result.error);
+            query.result.set_value(std::move(result));
+        }
+    }
+
+    std::vector<audit::Entry> AuditLog::ReadRecent(const std::string& player, const std::size_t limit, std::string* error) const
+    {
+        std::vector<audit::Entry> entries;
+        if (fd_ < 0)
+        {
+            if (error)
+            {
+                *error = "Audit log is not open.";
+            }
+            return entries;
+        }
+
+        struct stat info{};
+        fstat(fd_, &info);
+        const std::size_t header_size = sizeof(audit::kFileMagic);
+        const std::size_t size = static_cast<std::size_t>(info.st_size);
+        const std::size_t end = audit::CountRecords(size);
+        std::size_t remaining = std::min(end, kMaxScanRecords);
+
+        const std::string wanted = ToLower(player);
+        std::vector<unsigned char> chunk(kReadChunkRecords * audit::kRecordSize);
+        std::size_t next = end;
+        while (remaining > 0 && entries.size() < limit)
+        {
+            const std::size_t count = std::min(remaining, kReadChunkRecords);
+            const std::size_t first = next - count;
+            const std::size_t bytes = count * audit::kRecordSize;
+            const off_t offset = static_cast<off_t>(header_size + first * audit::kRecordSize);
+            if (pread(fd_, chunk.data(), bytes, offset) != static_cast<ssize_t>(bytes))
+            {
+                if (error)
+                {
+                    *error = std::string("Unable to read audit log: ") + std::strerror(errno);
+                }
+                break;
+            }
+
+            for (std::size_t i = count; i-- > 0 && entries.size() < limit;)
+            {
+                audit::Entry entry;
+                if (!audit::Decode(chunk.data() + i * audit::kRecordSize, entry))
+                {
+                    continue;
+                }
+                if (!wanted.empty() && ToLower(entry.player) != wanted && FormatUuid(entry.sender) != wanted)
+                {
+                    continue;
+                }
+                entries.push_back(std::move(entry));
+            }
+            next = first;
+            remaining -= count;
+        }
+        return entries;
+    }
+}
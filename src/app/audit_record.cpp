@@ -0,0 +1,161 @@
+#include "absinthe/audit_log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace absinthe
+{
+    namespace
+    {
+        constexpr std::size_t kChecksumOffset = audit::kRecordSize - 4;
+        constexpr std::size_t kPlayerOffset = 32;
+        constexpr std::size_t kCommandOffset = kPlayerOffset + audit::kMaxPlayerLength;
+
+        struct Crc32Table
+        {
+            std::uint32_t values[256];
+
+            constexpr Crc32Table()
+                : values()
+            {
+                for (std::uint32_t i = 0; i < 256; ++i)
+                {
+                    std::uint32_t value = i;
+                    for (int bit = 0; bit < 8; ++bit)
+                    {
+                        value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+                    }
+                    values[i] = value;
+                }
+            }
+        };
+
+        constexpr Crc32Table kCrc32Table;
+
+        std::uint32_t Crc32(const unsigned char* data, const std::size_t size)
+        {
+            std::uint32_t crc = 0xFFFFFFFFu;
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                crc = kCrc32Table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+            }
+            return crc ^ 0xFFFFFFFFu;
+        }
+
+        void PutLittleEndian(unsigned char* out, std::uint64_t value, const int bytes)
+        {
+            for (int i = 0; i < bytes; ++i)
+            {
+                out[i] = static_cast<unsigned char>(value & 0xFF);
+                value >>= 8;
+            }
+        }
+
+        std::uint64_t GetLittleEndian(const unsigned char* data, const int bytes)
+        {
+            std::uint64_t value = 0;
+            for (int i = bytes - 1; i >= 0; --i)
+            {
+                value = (value << 8) | data[i];
+            }
+            return value;
+        }
+    }
+
+    const char* audit::GetName(const Source source)
+    {
+        switch (source)
+        {
+        case Source::Chat:
+            return "chat";
+        case Source::Console:
+            return "console";
+        case Source::Control:
+            return "control";
+        }
+        return "unknown";
+    }
+
+    const char* audit::GetName(const Result result)
+    {
+        switch (result)
+        {
+        case Result::Ok:
+            return "ok";
+        case Result::Denied:
+            return "denied";
+        case Result::Failed:
+            return "failed";
+        case Result::Cancelled:
+            return "cancelled";
+        }
+        return "unknown";
+    }
+
+    const char* audit::GetName(const Signature signature)
+    {
+        switch (signature)
+        {
+        case Signature::None:
+            return "none";
+        case Signature::Missing:
+            return "missing";
+        case Signature::Unchecked:
+            return "unchecked";
+        case Signature::Verified:
+            return "verified";
+        case Signature::Invalid:
+            return "invalid";
+        }
+        return "unknown";
+    }
+
+    void audit::Encode(const Entry& entry, unsigned char* out)
+    {
+        std::memset(out, 0, kRecordSize);
+        const std::size_t player_length = std::min(entry.player.size(), kMaxPlayerLength);
+        const std::size_t command_length = std::min(entry.command.size(), kMaxCommandLength);
+        PutLittleEndian(out, static_cast<std::uint64_t>(entry.time_ms), 8);
+        std::memcpy(out + 8, entry.sender.data(), entry.sender.size());
+        out[24] = static_cast<unsigned char>(entry.source);
+        out[25] = static_cast<unsigned char>(entry.result);
+        out[26] = static_cast<unsigned char>(entry.signature);
+        out[27] = static_cast<unsigned char>(player_length);
+        PutLittleEndian(out + 28, command_length, 2);
+        std::memcpy(out + kPlayerOffset, entry.player.data(), player_length);
+        std::memcpy(out + kCommandOffset, entry.command.data(), command_length);
+    }
+
+    void audit::Seal(unsigned char* record)
+    {
+        PutLittleEndian(record + kChecksumOffset, Crc32(record, kChecksumOffset), 4);
+    }
+
+    bool audit::Decode(const unsigned char* data, Entry& entry)
+    {
+        if (GetLittleEndian(data + kChecksumOffset, 4) != Crc32(data, kChecksumOffset))
+        {
+            return false;
+        }
+        const std::size_t player_length = data[27];
+        const std::size_t command_length = GetLittleEndian(data + 28, 2);
+        if (player_length > kMaxPlayerLength || command_length > kMaxCommandLength)
+        {
+            return false;
+        }
+        entry.time_ms = static_cast<std::int64_t>(GetLittleEndian(data, 8));
+        std::memcpy(entry.sender.data(), data + 8, entry.sender.size());
+        entry.source = static_cast<Source>(data[24]);
+        entry.result = static_cast<Result>(data[25]);
+        entry.signature = static_cast<Signature>(data[26]);
+        entry.player.assign(reinterpret_cast<const char*>(data + kPlayerOffset), player_length);
+        entry.command.assign(reinterpret_cast<const char*>(data + kCommandOffset), command_length);
+        return true;
+    }
+
+    std::size_t audit::CountRecords(const std::size_t file_size)
+    {
+        const std::size_t header_size = sizeof(kFileMagic);
+        return file_size > header_size ? (file_size - header_size) / kRecordSize : 0;
+    }
+}
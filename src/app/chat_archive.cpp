@@ -0,0 +1,596 @@
+#include "absinthe/chat_archive.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if USE_ARCHIVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "botcraft/Utilities/Logger.hpp"
+#include "absinthe/metrics.hpp"
+#include "absinthe/thread_layout.hpp"
+#include "absinthe/trace.hpp"
+
+namespace absinthe
+{
+    namespace
+    {
+        constexpr std::size_t kBlockRecords = 1024;
+        constexpr std::size_t kBlockBytes = 128 * 1024;
+        constexpr std::size_t kMaxPendingRecords = 64 * 1024;
+        constexpr auto kFlushInterval = std::chrono::seconds(2);
+
+        void PutU8(std::string& out, const std::uint8_t value)
+        {
+            out.push_back(static_cast<char>(value));
+        }
+
+        void PutU16(std::string& out, const std::uint16_t value)
+        {
+            for (int i = 0; i < 2; ++i)
+            {
+                out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+            }
+        }
+
+        void PutU32(std::string& out, const std::uint32_t value)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+            }
+        }
+
+        void PutU64(std::string& out, const std::uint64_t value)
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+            }
+        }
+
+        std::uint64_t GetLittleEndian(const unsigned char* data, const int bytes)
+        {
+            std::uint64_t value = 0;
+            for (int i = bytes - 1; i >= 0; --i)
+            {
+                value = (value << 8) | data[i];
+            }
+            return value;
+        }
+
+        // Bounds-checked cursor over a mapped or inflated buffer.
+        struct Cursor
+        {
+            const unsigned char* data;
+            std::size_t size;
+            std::size_t offset = 0;
+
+            bool Has(const std::size_t bytes) const { return size - offset >= bytes; }
+
+            std::uint64_t Read(const int bytes)
+            {
+                const std::uint64_t value = GetLittleEndian(data + offset, bytes);
+                offset += bytes;
+                return value;
+            }
+        };
+
+        std::string FormatUuid(const ProtocolCraft::UUID& uuid)
+        {
+            static constexpr char kHex[] = "0123456789abcdef";
+            std::string output;
+            output.reserve(36);
+            for (size_t i = 0; i < uuid.size(); ++i)
+            {
+                if (i == 4 || i == 6 || i == 8 || i == 10)
+                {
+                    output.push_back('-');
+                }
+                output.push_back(kHex[(uuid[i] >> 4) & 0xF]);
+                output.push_back(kHex[uuid[i] & 0xF]);
+            }
+            return output;
+        }
+
+        std::string ToLower(std::string value)
+        {
+            std::transform(value.begin(), value.end(), value.begin(), [](const unsigned char c) {
+                return static_cast<char>(std::tolower(c));
+            });
+            return value;
+        }
+
+        std::int64_t UnixMillis()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        bool ReadBlockHeader(Cursor& cursor, archive::BlockHeader& header)
+        {
+            if (!cursor.Has(archive::kBlockHeaderSize) || cursor.Read(4) != archive::kBlockMagic)
+            {
+                return false;
+            }
+            header.codec = static_cast<archive::Codec>(cursor.Read(1));
+            cursor.offset += 3;
+            header.record_count = static_cast<std::uint32_t>(cursor.Read(4));
+            header.raw_size = static_cast<std::uint32_t>(cursor.Read(4));
+            header.stored_size = static_cast<std::uint32_t>(cursor.Read(4));
+            header.index_size = static_cast<std::uint32_t>(cursor.Read(4));
+            header.first_ms = static_cast<std::int64_t>(cursor.Read(8));
+            header.last_ms = static_cast<std::int64_t>(cursor.Read(8));
+            return true;
+        }
+
+        struct IndexEntry
+        {
+            ProtocolCraft::UUID uuid{};
+            std::string name;
+        };
+
+        bool ReadSenderIndex(Cursor cursor, std::vector<IndexEntry>& senders)
+        {
+            if (!cursor.Has(2))
+            {
+                return false;
+            }
+            const std::size_t count = cursor.Read(2);
+            senders.resize(count);
+            for (IndexEntry& sender : senders)
+            {
+                if (!cursor.Has(sender.uuid.size() + 1))
+                {
+                    return false;
+                }
+                std::memcpy(sender.uuid.data(), cursor.data + cursor.offset, sender.uuid.size());
+                cursor.offset += sender.uuid.size();
+                const std::size_t length = cursor.Read(1);
+                if (!cursor.Has(length))
+                {
+                    return false;
+                }
+                sender.name.assign(reinterpret_cast<const char*>(cursor.data + cursor.offset), length);
+                cursor.offset += length;
+            }
+            return true;
+        }
+
+        // Walks the block headers and returns the end of the last complete
+        // block, so a block torn by a crash can be cut off before appending.
+        std::size_t FindCompleteEnd(std::FILE* file, const std::size_t size)
+        {
+            std::size_t end = sizeof(archive::kFileMagic);
+            unsigned char bytes[archive::kBlockHeaderSize];
+            while (size - end >= archive::kBlockHeaderSize)
+            {
+                archive::BlockHeader header;
+                Cursor cursor{ bytes, sizeof(bytes) };
+                if (std::fseek(file, static_cast<long>(end), SEEK_SET) != 0
+                    || std::fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes)
+                    || !ReadBlockHeader(cursor, header))
+                {
+                    break;
+                }
+                const std::size_t block_size = archive::kBlockHeaderSize + header.index_size + header.stored_size;
+                if (size - end < block_size)
+                {
+                    break;
+                }
+                end += block_size;
+            }
+            return end;
+        }
+    }
+
+    bool archive::IsCodecSupported(const Codec codec)
+    {
+#if USE_ARCHIVE_ZLIB
+        return codec == Codec::Stored || codec == Codec::Zlib;
+#else
+        return codec == Codec::Stored;
+#endif
+    }
+
+    ChatArchive::~ChatArchive()
+    {
+        Close();
+    }
+
+    bool ChatArchive::Open(const std::string& path, std::string* error)
+    {
+        file_ = std::fopen(path.c_str(), "ab+");
+        if (!file_)
+        {
+            if (error)
+            {
+                *error = "Unable to open chat archive: " + path;
+            }
+            return false;
+        }
+
+        std::fseek(file_, 0, SEEK_END);
+        const std::size_t size = static_cast<std::size_t>(std::ftell(file_));
+        if (size == 0)
+        {
+            std::fwrite(archive::kFileMagic, 1, sizeof(archive::kFileMagic), file_);
+            std::fflush(file_);
+        }
+        else
+        {
+            char magic[sizeof(archive::kFileMagic)] = {};
+            std::fseek(file_, 0, SEEK_SET);
+            if (std::fread(magic, 1, sizeof(magic), file_) != sizeof(magic)
+                || std::memcmp(magic, archive::kFileMagic, sizeof(magic)) != 0)
+            {
+                std::fclose(file_);
+                file_ = nullptr;
+                if (error)
+                {
+                    *error = "Not a chat archive: " + path;
+                }
+                return false;
+            }
+
+            // Blocks appended after a torn one would be hidden from readers,
+            // which stop at the first incomplete block.
+            const std::size_t end = FindCompleteEnd(file_, size);
+            if (end != size && ftruncate(fileno(file_), static_cast<off_t>(end)) == 0)
+            {
+                LOG_WARNING("Dropped " << size - end << " bytes of a torn block at the end of " << path);
+            }
+            std::fseek(file_, 0, SEEK_END);
+        }
+
+        pending_.reserve(kBlockRecords);
+        stopping_ = false;
+        thread_ = std::thread(&ChatArchive::Run, this);
+        return true;
+    }
+
+    void ChatArchive::Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        condition_.notify_one();
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+        if (file_)
+        {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+    void ChatArchive::Append(const ChatMessage& message)
+    {
+        archive::Record record;
+        record.time_ms = UnixMillis();
+        record.sender = message.sender;
+        record.sender_name = message.sender_name.substr(0, 255);
+        record.content = message.content.substr(0, 0xFFFF);
+        record.flags = (message.has_signature ? archive::kHasSignature : 0)
+            | (message.secure_chat_enforced ? archive::kSecureChatEnforced : 0);
+
+        bool full = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pending_.size() >= kMaxPendingRecords)
+            {
+                Metrics::GetInstance().Add("absinthe_archive_dropped_total", 1);
+                return;
+            }
+            pending_bytes_ += record.content.size();
+            pending_.push_back(std::move(record));
+            full = pending_.size() >= kBlockRecords || pending_bytes_ >= kBlockBytes;
+        }
+        if (full)
+        {
+            condition_.notify_one();
+        }
+    }
+
+    void ChatArchive::Run()
+    {
+        Tracer::SetThreadName("archive");
+        ThreadLayout::GetInstance().ApplyToCurrentThread(ThreadRole::Persistence, "archive");
+        std::vector<archive::Record> block;
+        block.reserve(kBlockRecords);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            condition_.wait_for(lock, kFlushInterval, [this]() {
+                return stopping_ || pending_.size() >= kBlockRecords || pending_bytes_ >= kBlockBytes;
+            });
+
+            block.swap(pending_);
+            pending_bytes_ = 0;
+            const bool stopping = stopping_;
+            lock.unlock();
+
+            // Oversized swaps from a burst are cut into block-sized pieces.
+            for (size_t start = 0; start < block.size(); start += kBlockRecords)
+            {
+                const size_t end = std::min(block.size(), start + kBlockRecords);
+                WriteBlock(std::vector<archive::Record>(std::make_move_iterator(block.begin() + start),
+                    std::make_move_iterator(block.begin() + end)));
+            }
+            block.clear();
+
+            lock.lock();
+            if (stopping && pending_.empty())
+            {
+                return;
+            }
+        }
+    }
+
+    void ChatArchive::WriteBlock(const std::vector<archive::Record>& records)
+    {
+        if (records.empty())
+        {
+            return;
+        }
+
+        ABSINTHE_TRACE_SPAN("archive block");
+        std::map<ProtocolCraft::UUID, std::uint16_t> sender_ids;
+        std::string index;
+        std::string payload;
+        PutU16(index, 0);
+        std::int64_t first_ms = records.front().time_ms;
+        std::int64_t last_ms = records.front().time_ms;
+        for (const archive::Record& record : records)
+        {
+            auto [it, inserted] = sender_ids.emplace(record.sender, static_cast<std::uint16_t>(sender_ids.size()));
+            if (inserted)
+            {
+                index.append(reinterpret_cast<const char*>(record.sender.data()), record.sender.size());
+                PutU8(index, static_cast<std::uint8_t>(record.sender_name.size()));
+                index += record.sender_name;
+            }
+
+            first_ms = std::min(first_ms, record.time_ms);
+            last_ms = std::max(last_ms, record.time_ms);
+            PutU64(payload, static_cast<std::uint64_t>(record.time_ms));
+            PutU16(payload, it->second);
+            PutU8(payload, record.flags);
+            PutU16(payload, static_cast<std::uint16_t>(record.content.size()));
+            payload += record.content;
+        }
+        index[0] = static_cast<char>(sender_ids.size() & 0xFF);
+        index[1] = static_cast<char>((sender_ids.size() >> 8) & 0xFF);
+
+        archive::Codec codec = archive::Codec::Stored;
+        std::string stored;
+#if USE_ARCHIVE_ZLIB
+        uLongf compressed_size = compressBound(static_cast<uLong>(payload.size()));
+        stored.resize(compressed_size);
+        if (compress2(reinterpret_cast<Bytef*>(stored.data()), &compressed_size,
+                reinterpret_cast<const Bytef*>(payload.data()), static_cast<uLong>(payload.size()), Z_DEFAULT_COMPRESSION) == Z_OK
+            && compressed_size < payload.size())
+        {
+            stored.resize(compressed_size);
+            codec = archive::Codec::Zlib;
+        }
+        else
+        {
+            stored.clear();
+        }
+#endif
+        const std::string& body = codec == archive::Codec::Stored ? payload : stored;
+
+        std::string header;
+        header.reserve(archive::kBlockHeaderSize);
+        PutU32(header, archive::kBlockMagic);
+        PutU8(header, static_cast<std::uint8_t>(codec));
+        header.append(3, '\0');
+        PutU32(header, static_cast<std::uint32_t>(records.size()));
+        PutU32(header, static_cast<std::uint32_t>(payload.size()));
+        PutU32(header, static_cast<std::uint32_t>(body.size()));
+        PutU32(header, static_cast<std::uint32_t>(index.size()));
+        PutU64(header, static_cast<std::uint64_t>(first_ms));
+        PutU64(header, static_cast<std::uint64_t>(last_ms));
+
+        const long start = std::ftell(file_);
+        const bool written = std::fwrite(header.data(), 1, header.size(), file_) == header.size()
+            && std::fwrite(index.data(), 1, index.size(), file_) == index.size()
+            && std::fwrite(body.data(), 1, body.size(), file_) == body.size()
+            && std::fflush(file_) == 0;
+        if (!written)
+        {
+            // Cut the partial block off so later blocks stay readable.
+            std::clearerr(file_);
+            if (start >= 0 && ftruncate(fileno(file_), static_cast<off_t>(start)) == 0)
+            {
+                std::fseek(file_, 0, SEEK_END);
+            }
+            LOG_ERROR("Failed to write chat archive block of " << records.size() << " messages");
+            return;
+        }
+
+        Metrics& metrics = Metrics::GetInstance();
+        metrics.Add("absinthe_archive_records_total", static_cast<double>(records.size()));
+        metrics.Add("absinthe_archive_raw_bytes_total", static_cast<double>(payload.size()));
+        metrics.Add("absinthe_archive_stored_bytes_total", static_cast<double>(header.size() + index.size() + body.size()));
+    }
+
+    ChatArchiveReader::~ChatArchiveReader()
+    {
+        if (data_)
+        {
+            munmap(const_cast<unsigned char*>(data_), size_);
+        }
+    }
+
+    bool ChatArchiveReader::Open(const std::string& path, std::string* error)
+    {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            if (error)
+            {
+                *error = "Unable to open chat archive: " + path;
+            }
+            return false;
+        }
+
+        struct stat info {};
+        if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(archive::kFileMagic))
+        {
+            close(fd);
+            if (error)
+            {
+                *error = "Not a chat archive: " + path;
+            }
+            return false;
+        }
+
+        void* mapping = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            if (error)
+            {
+                *error = "Unable to map chat archive: " + path;
+            }
+            return false;
+        }
+        madvise(mapping, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+
+        data_ = static_cast<const unsigned char*>(mapping);
+        size_ = static_cast<std::size_t>(info.st_size);
+        if (std::memcmp(data_, archive::kFileMagic, sizeof(archive::kFileMagic)) != 0)
+        {
+            if (error)
+            {
+                *error = "Not a chat archive: " + path;
+            }
+            return false;
+        }
+        return true;
+    }
+
+    bool ChatArchiveReader::Scan(const Query& query, const std::function<void(const archive::Record&)>& callback,
+        Stats* stats, std::string* error) const
+    {
+        Stats local;
+        Stats& counters = stats ? *stats : local;
+        const std::string wanted = ToLower(query.sender);
+
+        Cursor cursor{ data_, size_, sizeof(archive::kFileMagic) };
+        std::vector<IndexEntry> senders;
+        std::vector<bool> sender_matches;
+        std::vector<unsigned char> inflated;
+        archive::Record record;
+        while (cursor.offset < size_)
+        {
+            archive::BlockHeader header;
+            if (!ReadBlockHeader(cursor, header) || !cursor.Has(static_cast<std::size_t>(header.index_size) + header.stored_size))
+            {
+                // A torn final block from an interrupted write ends the archive.
+                LOG_WARNING("Chat archive ends with an incomplete block at offset " << cursor.offset);
+                return true;
+            }
+            const std::size_t index_offset = cursor.offset;
+            const std::size_t payload_offset = index_offset + header.index_size;
+            cursor.offset = payload_offset + header.stored_size;
+            ++counters.blocks;
+
+            if (header.last_ms < query.from_ms || header.first_ms > query.to_ms)
+            {
+                continue;
+            }
+
+            if (!ReadSenderIndex(Cursor{ data_ + index_offset, header.index_size }, senders))
+            {
+                if (error)
+                {
+                    *error = "Corrupt sender index in block at offset " + std::to_string(index_offset);
+                }
+                return false;
+            }
+            sender_matches.assign(senders.size(), wanted.empty());
+            bool any_sender = wanted.empty();
+            for (size_t i = 0; i < senders.size() && !wanted.empty(); ++i)
+            {
+                sender_matches[i] = ToLower(senders[i].name) == wanted || FormatUuid(senders[i].uuid) == wanted;
+                any_sender = any_sender || sender_matches[i];
+            }
+            if (!any_sender)
+            {
+                continue;
+            }
+
+            if (!archive::IsCodecSupported(header.codec))
+            {
+                if (error)
+                {
+                    *error = "Block at offset " + std::to_string(index_offset) + " uses a codec this build cannot read";
+                }
+                return false;
+            }
+
+            const unsigned char* payload = data_ + payload_offset;
+#if USE_ARCHIVE_ZLIB
+            if (header.codec == archive::Codec::Zlib)
+            {
+                inflated.resize(header.raw_size);
+                uLongf inflated_size = header.raw_size;
+                if (uncompress(inflated.data(), &inflated_size, payload, header.stored_size) != Z_OK
+                    || inflated_size != header.raw_size)
+                {
+                    if (error)
+                    {
+                        *error = "Corrupt compressed block at offset " + std::to_string(payload_offset);
+                    }
+                    return false;
+                }
+                payload = inflated.data();
+            }
+#endif
+            ++counters.blocks_decoded;
+
+            Cursor records{ payload, header.codec == archive::Codec::Stored ? header.stored_size : header.raw_size };
+            for (std::uint32_t i = 0; i < header.record_count; ++i)
+            {
+                if (!records.Has(13))
+                {
+                    break;
+                }
+                record.time_ms = static_cast<std::int64_t>(records.Read(8));
+                const std::size_t sender = records.Read(2);
+                record.flags = static_cast<std::uint8_t>(records.Read(1));
+                const std::size_t length = records.Read(2);
+                if (!records.Has(length) || sender >= senders.size())
+                {
+                    break;
+                }
+                ++counters.records;
+                if (sender_matches[sender] && record.time_ms >= query.from_ms && record.time_ms <= query.to_ms)
+                {
+                    record.sender = senders[sender].uuid;
+                    record.sender_name = senders[sender].name;
+                    record.content.assign(reinterpret_cast<const char*>(records.data + records.offset), length);
+                    ++counters.matches;
+                    callback(record);
+                }
+                records.offset += length;
+            }
+        }
+        return true;
+    }
+}
@@ -1,78 +1,233 @@
 #include "absinthe/chat_client.hpp"
+#include "absinthe/chat_archive.hpp"
+#include "absinthe/signature_verifier.hpp"
+#include "absinthe/thread_layout.hpp"
+#include "absinthe/trace.hpp"
 
+#include "botcraft/Network/NetworkManager.hpp"
 #include "botcraft/Utilities/Logger.hpp"
 #include "protocolCraft/Packets/Game/Clientbound/ClientboundLoginPacket.hpp"
 #include "protocolCraft/Packets/Game/Clientbound/ClientboundPlayerChatPacket.hpp"
+#include "protocolCraft/enums.hpp"
+#if PROTOCOL_VERSION > 760 /* > 1.19.2 */
+#include "protocolCraft/Packets/Game/Clientbound/ClientboundPlayerInfoRemovePacket.hpp"
+#include "protocolCraft/Packets/Game/Clientbound/ClientboundPlayerInfoUpdatePacket.hpp"
+#endif
 
 namespace absinthe
 {
-    ChatBehaviourClient::ChatBehaviourClient(bool use_renderer)
-        : Botcraft::TemplatedBehaviourClient<ChatBehaviourClient>(use_renderer)
+    void ChatInbox::PushMessage(ChatMessage message)
     {
+        std::lock_guard<std::mutex> lock(mutex);
+        messages.push_back(std::move(message));
     }
 
-    bool ChatBehaviourClient::PopChatMessage(ChatMessage& message)
+    bool ChatInbox::PopMessage(ChatMessage& message)
     {
-        std::lock_guard<std::mutex> lock(chat_mutex);
-        if (chat_messages.empty())
+        std::lock_guard<std::mutex> lock(mutex);
+        if (messages.empty())
         {
             return false;
         }
-        message = std::move(chat_messages.front());
-        chat_messages.pop_front();
+        message = std::move(messages.front());
+        messages.pop_front();
         return true;
     }
 
-    bool ChatBehaviourClient::IsSecureChatEnforced() const
+#if PROTOCOL_VERSION > 758 /* > 1.18.2 */
+    bool ReadPlayerChat(ProtocolCraft::ClientboundPlayerChatPacket& packet, ChatMessage& message)
+    {
+#if PROTOCOL_VERSION > 760 /* > 1.19.2 */
+        message.received_ns = Tracer::Now();
+        message.sender = packet.GetSender();
+        message.has_signature = packet.GetSignature().has_value();
+        if (packet.GetUnsignedContent().has_value())
+        {
+            // The signature covers the body only, not the server's rewrite.
+            message.content = packet.GetUnsignedContent()->GetText();
+            message.has_signature = message.has_signature && message.content == packet.GetBody().GetContent();
+        }
+        else
+        {
+            message.content = packet.GetBody().GetContent();
+        }
+        return !message.content.empty();
+#else
+        (void)packet;
+        (void)message;
+        return false;
+#endif
+    }
+#endif
+
+    bool ChatPacketHandler::PopChatMessage(ChatMessage& message)
+    {
+        return inbox.PopMessage(message);
+    }
+
+    bool ChatPacketHandler::IsSecureChatEnforced() const
     {
         return secure_chat_enforced;
     }
 
-    void ChatBehaviourClient::Handle(ProtocolCraft::ClientboundLoginPacket& packet)
+    void ChatPacketHandler::SetSignatureVerifier(ChatSignatureVerifier* verifier)
+    {
+        signature_verifier = verifier;
+    }
+
+    void ChatPacketHandler::SetArchive(ChatArchive* sink)
+    {
+        archive = sink;
+    }
+
+    void ChatPacketHandler::OnLogin(ProtocolCraft::ClientboundLoginPacket& packet)
     {
-        Botcraft::ManagersClient::Handle(packet);
 #if PROTOCOL_VERSION > 765 /* > 1.20.4 */
         secure_chat_enforced = packet.GetEnforceSecureChat();
         LOG_INFO("Server enforce secure chat: " << (secure_chat_enforced ? "true" : "false"));
 #else
+        (void)packet;
         secure_chat_enforced = false;
 #endif
+        Tracer::SetThreadName("network");
+        ThreadLayout::GetInstance().RegisterCurrentThread(ThreadRole::Network);
     }
 
-#if PROTOCOL_VERSION > 758 /* > 1.18.2 */
-    void ChatBehaviourClient::Handle(ProtocolCraft::ClientboundPlayerChatPacket& packet)
-    {
-        ChatMessage message;
 #if PROTOCOL_VERSION > 760 /* > 1.19.2 */
-        message.sender = packet.GetSender();
-        message.has_signature = packet.GetSignature().has_value();
-        if (packet.GetUnsignedContent().has_value())
+    void ChatPacketHandler::OnPlayerInfoUpdate(ProtocolCraft::ClientboundPlayerInfoUpdatePacket& packet)
+    {
+        if (signature_verifier)
         {
-            message.content = packet.GetUnsignedContent()->GetText();
+            signature_verifier->UpdateSessions(packet);
         }
-        else
+    }
+
+    void ChatPacketHandler::OnPlayerInfoRemove(ProtocolCraft::ClientboundPlayerInfoRemovePacket& packet)
+    {
+        if (signature_verifier)
         {
-            message.content = packet.GetBody().GetContent();
+            signature_verifier->RemoveSessions(packet);
         }
-#else
-        (void)packet;
-        return;
+    }
 #endif
 
+#if PROTOCOL_VERSION > 758 /* > 1.18.2 */
+    bool ChatPacketHandler::Decode(ProtocolCraft::ClientboundPlayerChatPacket& packet, ChatMessage& message) const
+    {
+        if (!ReadPlayerChat(packet, message))
+        {
+            return false;
+        }
         message.secure_chat_enforced = secure_chat_enforced;
-        message.sender_name = GetPlayerName(message.sender);
-        if (message.sender_name.empty())
+        return true;
+    }
+
+    void ChatPacketHandler::Deliver(ProtocolCraft::ClientboundPlayerChatPacket& packet, ChatMessage message, const bool readable)
+    {
+        if (readable)
         {
-            message.sender_name = "unknown";
+            if (message.sender_name.empty())
+            {
+                message.sender_name = "unknown";
+            }
+            if (archive)
+            {
+                archive->Append(message);
+            }
         }
 
-        if (message.content.empty())
+#if PROTOCOL_VERSION > 760 /* > 1.19.2 */
+        // The verifier sees every message to keep its last-seen cache in step,
+        // and takes over delivery of the command candidates it can check.
+        if (signature_verifier && signature_verifier->Submit(packet, message, inbox))
         {
             return;
         }
+#else
+        (void)packet;
+#endif
+
+        if (readable)
+        {
+            inbox.PushMessage(std::move(message));
+        }
+    }
+#endif
+
+    ChatBehaviourClient::ChatBehaviourClient(bool use_renderer)
+        : Botcraft::TemplatedBehaviourClient<ChatBehaviourClient>(use_renderer)
+    {
+    }
 
-        std::lock_guard<std::mutex> lock(chat_mutex);
-        chat_messages.push_back(std::move(message));
+    bool ChatBehaviourClient::PopChatMessage(ChatMessage& message)
+    {
+        return chat.PopChatMessage(message);
+    }
+
+    void ChatBehaviourClient::SendChat(const std::string& text)
+    {
+        SendChatMessage(text);
+    }
+
+    bool ChatBehaviourClient::IsConnected() const
+    {
+        const auto manager = GetNetworkManager();
+        return !GetShouldBeClosed() && manager && manager->GetConnectionState() == ProtocolCraft::ConnectionState::Play;
+    }
+
+    void ChatBehaviourClient::Close()
+    {
+        SetShouldBeClosed(true);
+    }
+
+    void ChatBehaviourClient::SetSignatureVerifier(ChatSignatureVerifier* verifier)
+    {
+        chat.SetSignatureVerifier(verifier);
+    }
+
+    void ChatBehaviourClient::SetArchive(ChatArchive* sink)
+    {
+        chat.SetArchive(sink);
+    }
+
+    bool ChatBehaviourClient::IsSecureChatEnforced() const
+    {
+        return chat.IsSecureChatEnforced();
+    }
+
+    void ChatBehaviourClient::Handle(ProtocolCraft::ClientboundLoginPacket& packet)
+    {
+        Botcraft::ManagersClient::Handle(packet);
+        chat.OnLogin(packet);
+    }
+
+#if PROTOCOL_VERSION > 760 /* > 1.19.2 */
+    void ChatBehaviourClient::Handle(ProtocolCraft::ClientboundPlayerInfoUpdatePacket& packet)
+    {
+        Botcraft::ManagersClient::Handle(packet);
+        chat.OnPlayerInfoUpdate(packet);
+    }
+
+    void ChatBehaviourClient::Handle(ProtocolCraft::ClientboundPlayerInfoRemovePacket& packet)
+    {
+        Botcraft::ManagersClient::Handle(packet);
+        chat.OnPlayerInfoRemove(packet);
+    }
+#endif
+
+#if PROTOCOL_VERSION > 758 /* > 1.18.2 */
+    void ChatBehaviourClient::Handle(ProtocolCraft::ClientboundPlayerChatPacket& packet)
+    {
+        ABSINTHE_TRACE_SPAN("decode chat packet");
+        // The base client tracks last-seen messages for signing our own chat.
+        Botcraft::ManagersClient::Handle(packet);
+        ChatMessage message;
+        const bool readable = chat.Decode(packet, message);
+        if (readable)
+        {
+            message.sender_name = GetPlayerName(message.sender);
+        }
+        chat.Deliver(packet, std::move(message), readable);
     }
 #endif
 }
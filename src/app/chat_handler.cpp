@@ -7,6 +7,15 @@ namespace absinthe
 {
     namespace
     {
+        constexpr size_t kMaxBatchSize = 16;
+
+        // Only allowlist edits can be chained with ';'. For anything else the
+        // ';' is part of the arguments, as in "echo a; b".
+        bool IsBatchable(const std::string& name)
+        {
+            return name == "allow" || name == "deny" || name == "list";
+        }
+
         bool StartsWith(const std::string& value, const std::string& prefix)
         {
             return value.rfind(prefix, 0) == 0;
@@ -34,6 +43,23 @@ namespace absinthe
             return words;
         }
 
+        std::vector<std::string> SplitBatch(const std::string& value)
+        {
+            std::vector<std::string> segments;
+            size_t start = 0;
+            while (true)
+            {
+                const size_t end = value.find(';', start);
+                segments.push_back(value.substr(start, end == std::string::npos ? std::string::npos : end - start));
+                if (end == std::string::npos)
+                {
+                    break;
+                }
+                start = end + 1;
+            }
+            return segments;
+        }
+
         std::string Join(const std::vector<std::string>& parts, const size_t start_index)
         {
             std::ostringstream stream;
@@ -59,6 +85,11 @@ namespace absinthe
         return prefix_;
     }
 
+    void ChatHandler::SetCommandResolver(CommandResolver resolver)
+    {
+        resolver_ = std::move(resolver);
+    }
+
     ChatParseResult ChatHandler::Parse(const std::string& message) const
     {
         ChatParseResult result;
@@ -76,23 +107,71 @@ namespace absinthe
             return result;
         }
 
-        const std::vector<std::string> words = SplitWords(rest);
-        if (words.empty())
+        const std::vector<std::string> first_words = SplitWords(rest.substr(0, rest.find(';')));
+        if (!first_words.empty() && !IsBatchable(first_words.front()))
+        {
+            const std::vector<std::string> words = SplitWords(rest);
+            result.ok = true;
+            result.command.name = words.front();
+            result.command.args.assign(words.begin() + 1, words.end());
+            if (resolver_)
+            {
+                result.command.id = resolver_(result.command.name);
+            }
+            return result;
+        }
+
+        std::vector<ChatCommand> commands;
+        for (std::string& segment : SplitBatch(rest))
+        {
+            TrimLeft(segment);
+            if (StartsWith(segment, prefix_))
+            {
+                segment.erase(0, prefix_.size());
+            }
+
+            const std::vector<std::string> segment_words = SplitWords(segment);
+            if (segment_words.empty())
+            {
+                continue;
+            }
+
+            ChatCommand command;
+            command.name = segment_words.front();
+            command.args.assign(segment_words.begin() + 1, segment_words.end());
+            if (resolver_)
+            {
+                command.id = resolver_(command.name);
+            }
+            if (!IsBatchable(command.name))
+            {
+                result.error = "\"" + command.name + "\" cannot be batched, only allow, deny and list can be chained with \";\".";
+                return result;
+            }
+            commands.push_back(std::move(command));
+        }
+
+        if (commands.empty())
         {
             result.error = "Malformed command. Usage: " + prefix_ + " <command> [args]. Try \"" + prefix_ + " help\".";
             return result;
         }
+        if (commands.size() > kMaxBatchSize)
+        {
+            result.error = "Batch too long: at most " + std::to_string(kMaxBatchSize) + " commands per message.";
+            return result;
+        }
 
         result.ok = true;
-        result.command.name = words.front();
-        if (words.size() > 1)
+        result.command = commands.front();
+        if (commands.size() > 1)
         {
-            result.command.args.assign(words.begin() + 1, words.end());
+            result.batch = std::move(commands);
         }
         return result;
     }
 
-    std::optional<std::string> ChatHandler::HandleCommand(const ChatCommand& command) const
+    std::vector<std::string> ChatHandler::HandleCommand(const ChatCommand& command) const
     {
         if (command.name == "help")
         {
@@ -101,24 +180,52 @@ namespace absinthe
 
         if (command.name == "ping")
         {
-            return std::string("pong");
+            return { "pong" };
         }
 
         if (command.name == "echo")
         {
             if (command.args.empty())
             {
-                return std::string("Malformed command. Usage: ") + prefix_ + " echo <text>.";
+                return { "Malformed command. Usage: " + prefix_ + " echo <text>." };
             }
-            return Join(command.args, 0);
+            return { Join(command.args, 0) };
         }
 
-        return std::string("Unknown command \"") + command.name + "\". Try \"" + prefix_ + " help\".";
+        return { "Unknown command \"" + command.name + "\". Try \"" + prefix_ + " help\"." };
     }
 
-    std::string ChatHandler::FormatHelp() const
+    std::vector<std::string> ChatHandler::FormatHelp() const
     {
-        return "Commands: " + prefix_ + "help, " + prefix_ + "ping, " + prefix_ + "echo <text>, "
-            + prefix_ + "allow <name|uuid>, " + prefix_ + "deny <name|uuid>, " + prefix_ + "list";
+        const std::vector<std::string> usages = {
+            "help", "ping", "echo <text>", "allow <name|uuid>... [role]", "deny <name|uuid>... [role]", "list",
+            "remind <seconds> <text>", "search <terms> [player]", "last <player>", "triggers [reload]",
+            "prof [reset]", "plugins [reload]", "audit [player]"
+        };
+
+        // Packed into as few messages as fit the server's chat limit.
+        std::vector<std::string> lines{ "Commands:" };
+        for (size_t i = 0; i < usages.size(); ++i)
+        {
+            const std::string item = prefix_ + usages[i] + (i + 1 < usages.size() ? "," : ".");
+            if (lines.back().size() + 1 + item.size() > kMaxChatLength)
+            {
+                lines.push_back(item);
+            }
+            else
+            {
+                lines.back() += " " + item;
+            }
+        }
+        const std::string batch_note = "Chain allow/deny/list with \";\" to apply them as one batch.";
+        if (lines.back().size() + 1 + batch_note.size() > kMaxChatLength)
+        {
+            lines.push_back(batch_note);
+        }
+        else
+        {
+            lines.back() += " " + batch_note;
+        }
+        return lines;
     }
 }
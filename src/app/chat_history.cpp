@@ -0,0 +1,304 @@
+#include "absinthe/chat_history.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace absinthe
+{
+    namespace
+    {
+        constexpr std::size_t kMinArenaBytes = 256;
+        constexpr std::size_t kMaxTokensPerMessage = 64;
+        constexpr std::size_t kCompactThreshold = 64;
+
+        bool IsTokenByte(const unsigned char c)
+        {
+            return std::isalnum(c) != 0 || c == '_' || c >= 0x80;
+        }
+
+        std::string NormalizeName(const std::string& value)
+        {
+            std::string normalized = value;
+            std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](const unsigned char c) {
+                return static_cast<char>(std::tolower(c));
+            });
+            return normalized;
+        }
+    }
+
+    void ChatHistory::Postings::PopFront()
+    {
+        ++head;
+        if (head >= kCompactThreshold && head * 2 >= sequences.size())
+        {
+            sequences.erase(sequences.begin(), sequences.begin() + head);
+            head = 0;
+        }
+    }
+
+    bool ChatHistory::Postings::Contains(const std::uint64_t sequence) const
+    {
+        return std::binary_search(sequences.begin() + head, sequences.end(), sequence);
+    }
+
+    ChatHistory::ChatHistory(const std::size_t max_messages, const std::size_t arena_bytes)
+        : slots_(std::max<std::size_t>(max_messages, 1))
+        , arena_(std::max(arena_bytes, kMinArenaBytes))
+    {
+        tokens_.reserve(kMaxTokensPerMessage);
+    }
+
+    void ChatHistory::Tokenize(const std::string_view text, std::vector<std::string>& tokens)
+    {
+        tokens.clear();
+        size_t i = 0;
+        while (i < text.size() && tokens.size() < kMaxTokensPerMessage)
+        {
+            while (i < text.size() && !IsTokenByte(static_cast<unsigned char>(text[i])))
+            {
+                ++i;
+            }
+            const size_t start = i;
+            while (i < text.size() && IsTokenByte(static_cast<unsigned char>(text[i])))
+            {
+                ++i;
+            }
+            if (i > start)
+            {
+                std::string token(text.substr(start, i - start));
+                std::transform(token.begin(), token.end(), token.begin(), [](const unsigned char c) {
+                    return static_cast<char>(std::tolower(c));
+                });
+                tokens.push_back(std::move(token));
+            }
+        }
+        std::sort(tokens.begin(), tokens.end());
+        tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+    }
+
+    void ChatHistory::Record(const ChatMessage& message)
+    {
+        if (message.content.empty())
+        {
+            return;
+        }
+
+        if (next_sequence_ - first_sequence_ == slots_.size())
+        {
+            EvictOldest();
+        }
+
+        const std::uint32_t length = static_cast<std::uint32_t>(std::min(message.content.size(), arena_.size()));
+        const std::uint32_t offset = Allocate(length);
+        std::memcpy(arena_.data() + offset, message.content.data(), length);
+
+        const std::uint32_t sender = InternSender(message.sender_name);
+        const std::uint64_t sequence = next_sequence_++;
+        Slot& slot = slots_[sequence % slots_.size()];
+        slot.offset = offset;
+        slot.length = length;
+        slot.sender = sender;
+        slot.received = Clock::now();
+
+        senders_[sender].messages.sequences.push_back(sequence);
+        Tokenize(std::string_view(arena_.data() + offset, length), tokens_);
+        for (const std::string& token : tokens_)
+        {
+            index_[token].sequences.push_back(sequence);
+        }
+    }
+
+    // Messages are laid out in arrival order around the arena, so the bytes
+    // just past the tail always belong to the oldest message. Evict until the
+    // new content fits contiguously, wrapping to the start when the end of the
+    // arena is too short.
+    std::uint32_t ChatHistory::Allocate(const std::uint32_t length)
+    {
+        const std::uint32_t size = static_cast<std::uint32_t>(arena_.size());
+        while (true)
+        {
+            std::uint32_t offset = 0;
+            if (first_sequence_ == next_sequence_)
+            {
+                offset = 0;
+            }
+            else
+            {
+                const std::uint32_t head = GetSlot(first_sequence_).offset;
+                if (head < arena_tail_ && arena_tail_ + length <= size)
+                {
+                    offset = arena_tail_;
+                }
+                else if (head < arena_tail_ && length <= head)
+                {
+                    offset = 0;
+                }
+                else if (head > arena_tail_ && arena_tail_ + length <= head)
+                {
+                    offset = arena_tail_;
+                }
+                else
+                {
+                    EvictOldest();
+                    continue;
+                }
+            }
+
+            arena_tail_ = offset + length;
+            return offset;
+        }
+    }
+
+    void ChatHistory::EvictOldest()
+    {
+        const Slot& slot = GetSlot(first_sequence_);
+        Tokenize(std::string_view(arena_.data() + slot.offset, slot.length), tokens_);
+        for (const std::string& token : tokens_)
+        {
+            const auto it = index_.find(token);
+            if (it == index_.end())
+            {
+                continue;
+            }
+            it->second.PopFront();
+            if (it->second.IsEmpty())
+            {
+                index_.erase(it);
+            }
+        }
+
+        Sender& sender = senders_[slot.sender];
+        sender.messages.PopFront();
+        if (sender.messages.IsEmpty())
+        {
+            sender_ids_.erase(NormalizeName(sender.name));
+            sender.name.clear();
+            sender.messages = Postings{};
+            free_senders_.push_back(slot.sender);
+        }
+
+        ++first_sequence_;
+    }
+
+    std::uint32_t ChatHistory::InternSender(const std::string& name)
+    {
+        const std::string key = NormalizeName(name);
+        const auto it = sender_ids_.find(key);
+        if (it != sender_ids_.end())
+        {
+            return it->second;
+        }
+
+        std::uint32_t id = 0;
+        if (!free_senders_.empty())
+        {
+            id = free_senders_.back();
+            free_senders_.pop_back();
+        }
+        else
+        {
+            id = static_cast<std::uint32_t>(senders_.size());
+            senders_.emplace_back();
+        }
+        senders_[id].name = name;
+        sender_ids_.emplace(key, id);
+        return id;
+    }
+
+    const ChatHistory::Sender* ChatHistory::FindSender(const std::string& player) const
+    {
+        const auto it = sender_ids_.find(NormalizeName(player));
+        return it == sender_ids_.end() ? nullptr : &senders_[it->second];
+    }
+
+    const ChatHistory::Slot& ChatHistory::GetSlot(const std::uint64_t sequence) const
+    {
+        return slots_[sequence % slots_.size()];
+    }
+
+    ChatHistory::Entry ChatHistory::MakeEntry(const std::uint64_t sequence) const
+    {
+        const Slot& slot = GetSlot(sequence);
+        Entry entry;
+        entry.sender_name = senders_[slot.sender].name;
+        entry.content.assign(arena_.data() + slot.offset, slot.length);
+        entry.received = slot.received;
+        return entry;
+    }
+
+    std::vector<ChatHistory::Entry> ChatHistory::Search(const std::vector<std::string>& terms, const std::string& player, const std::size_t limit) const
+    {
+        std::vector<Entry> results;
+        std::vector<std::string> query;
+        std::vector<std::string> term_tokens;
+        for (const std::string& term : terms)
+        {
+            Tokenize(term, term_tokens);
+            query.insert(query.end(), term_tokens.begin(), term_tokens.end());
+        }
+        if (query.empty() || limit == 0)
+        {
+            return results;
+        }
+
+        std::vector<const Postings*> lists;
+        lists.reserve(query.size() + 1);
+        for (const std::string& token : query)
+        {
+            const auto it = index_.find(token);
+            if (it == index_.end())
+            {
+                return results;
+            }
+            lists.push_back(&it->second);
+        }
+        if (!player.empty())
+        {
+            const Sender* sender = FindSender(player);
+            if (!sender)
+            {
+                return results;
+            }
+            lists.push_back(&sender->messages);
+        }
+
+        // Walk the shortest list newest first and probe the others.
+        std::sort(lists.begin(), lists.end(), [](const Postings* a, const Postings* b) {
+            return a->GetSize() < b->GetSize();
+        });
+        const Postings& shortest = *lists.front();
+        for (size_t i = shortest.sequences.size(); i > shortest.head && results.size() < limit; --i)
+        {
+            const std::uint64_t sequence = shortest.sequences[i - 1];
+            const bool matches = std::all_of(lists.begin() + 1, lists.end(), [sequence](const Postings* postings) {
+                return postings->Contains(sequence);
+            });
+            if (matches)
+            {
+                results.push_back(MakeEntry(sequence));
+            }
+        }
+        return results;
+    }
+
+    std::optional<ChatHistory::Entry> ChatHistory::Last(const std::string& player) const
+    {
+        const Sender* sender = FindSender(player);
+        if (!sender || sender->messages.IsEmpty())
+        {
+            return std::nullopt;
+        }
+        return MakeEntry(sender->messages.sequences.back());
+    }
+
+    bool ChatHistory::HasSender(const std::string& player) const
+    {
+        return FindSender(player) != nullptr;
+    }
+
+    std::size_t ChatHistory::GetSize() const
+    {
+        return static_cast<std::size_t>(next_sequence_ - first_sequence_);
+    }
+}
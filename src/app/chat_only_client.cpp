@@ -0,0 +1,115 @@
+#include "absinthe/chat_only_client.hpp"
+#include "absinthe/trace.hpp"
+
+#include "botcraft/Network/NetworkManager.hpp"
+#include "protocolCraft/Packets/Game/Clientbound/ClientboundLoginPacket.hpp"
+#include "protocolCraft/Packets/Game/Clientbound/ClientboundPlayerChatPacket.hpp"
+#include "protocolCraft/enums.hpp"
+#if PROTOCOL_VERSION > 760 /* > 1.19.2 */
+#include "protocolCraft/Packets/Game/Clientbound/ClientboundPlayerInfoRemovePacket.hpp"
+#include "protocolCraft/Packets/Game/Clientbound/ClientboundPlayerInfoUpdatePacket.hpp"
+#endif
+
+namespace absinthe
+{
+    ChatOnlyClient::ChatOnlyClient()
+        : Botcraft::ConnectionClient()
+    {
+    }
+
+    bool ChatOnlyClient::PopChatMessage(ChatMessage& message)
+    {
+        return chat.PopChatMessage(message);
+    }
+
+    void ChatOnlyClient::SendChat(const std::string& text)
+    {
+        SendChatMessage(text);
+    }
+
+    bool ChatOnlyClient::IsConnected() const
+    {
+        const auto manager = GetNetworkManager();
+        return !GetShouldBeClosed() && manager && manager->GetConnectionState() == ProtocolCraft::ConnectionState::Play;
+    }
+
+    void ChatOnlyClient::Close()
+    {
+        SetShouldBeClosed(true);
+    }
+
+    void ChatOnlyClient::SetSignatureVerifier(ChatSignatureVerifier* verifier)
+    {
+        chat.SetSignatureVerifier(verifier);
+    }
+
+    void ChatOnlyClient::SetArchive(ChatArchive* sink)
+    {
+        chat.SetArchive(sink);
+    }
+
+    bool ChatOnlyClient::IsSecureChatEnforced() const
+    {
+        return chat.IsSecureChatEnforced();
+    }
+
+    std::string ChatOnlyClient::GetPlayerName(const ProtocolCraft::UUID& uuid) const
+    {
+        std::lock_guard<std::mutex> lock(names_mutex);
+        const auto it = player_names.find(uuid);
+        return it == player_names.end() ? std::string() : it->second;
+    }
+
+    void ChatOnlyClient::Handle(ProtocolCraft::ClientboundLoginPacket& packet)
+    {
+        Botcraft::ConnectionClient::Handle(packet);
+        chat.OnLogin(packet);
+    }
+
+#if PROTOCOL_VERSION > 760 /* > 1.19.2 */
+    void ChatOnlyClient::Handle(ProtocolCraft::ClientboundPlayerInfoUpdatePacket& packet)
+    {
+        Botcraft::ConnectionClient::Handle(packet);
+        {
+            std::lock_guard<std::mutex> lock(names_mutex);
+            for (const auto& [uuid, entry] : packet.GetEntries())
+            {
+                const std::string& name = entry.GetGameProfile().GetName();
+                if (!name.empty())
+                {
+                    player_names[uuid] = name;
+                }
+            }
+        }
+        chat.OnPlayerInfoUpdate(packet);
+    }
+
+    void ChatOnlyClient::Handle(ProtocolCraft::ClientboundPlayerInfoRemovePacket& packet)
+    {
+        Botcraft::ConnectionClient::Handle(packet);
+        {
+            std::lock_guard<std::mutex> lock(names_mutex);
+            for (const auto& uuid : packet.GetProfileIds())
+            {
+                player_names.erase(uuid);
+            }
+        }
+        chat.OnPlayerInfoRemove(packet);
+    }
+#endif
+
+#if PROTOCOL_VERSION > 758 /* > 1.18.2 */
+    void ChatOnlyClient::Handle(ProtocolCraft::ClientboundPlayerChatPacket& packet)
+    {
+        ABSINTHE_TRACE_SPAN("decode chat packet");
+        Botcraft::ConnectionClient::Handle(packet);
+        ChatMessage message;
+        const bool readable = chat.Decode(packet, message);
+        if (readable)
+        {
+            message.sender_name = GetPlayerName(message.sender);
+        }
+        chat.Deliver(packet, std::move(message), readable);
+    }
+#endif
+}
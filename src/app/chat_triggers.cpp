@@ -0,0 +1,361 @@
+#include "absinthe/chat_triggers.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include <ryml.hpp>
+#include <ryml_std.hpp>
+
+namespace absinthe
+{
+    namespace
+    {
+        unsigned char Fold(const unsigned char c)
+        {
+            return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c - 'A' + 'a') : c;
+        }
+
+        bool ReadTrigger(ryml::ConstNodeRef node, ChatTrigger& trigger, std::string* error)
+        {
+            if (!node.is_map())
+            {
+                node >> trigger.pattern;
+                return true;
+            }
+
+            if (!node.has_child(ryml::to_csubstr("pattern")))
+            {
+                if (error)
+                {
+                    *error = "Trigger entry is missing \"pattern\".";
+                }
+                return false;
+            }
+            node[ryml::to_csubstr("pattern")] >> trigger.pattern;
+
+            if (node.has_child(ryml::to_csubstr("action")))
+            {
+                std::string action;
+                node[ryml::to_csubstr("action")] >> action;
+                if (action == "reply")
+                {
+                    trigger.action = TriggerAction::Reply;
+                }
+                else if (action != "alert")
+                {
+                    if (error)
+                    {
+                        *error = "Unknown trigger action \"" + action + "\" for pattern \"" + trigger.pattern + "\".";
+                    }
+                    return false;
+                }
+            }
+
+            if (node.has_child(ryml::to_csubstr("reply")))
+            {
+                node[ryml::to_csubstr("reply")] >> trigger.reply;
+            }
+            if (trigger.action == TriggerAction::Reply && trigger.reply.empty())
+            {
+                if (error)
+                {
+                    *error = "Reply trigger \"" + trigger.pattern + "\" has no reply text.";
+                }
+                return false;
+            }
+
+            if (node.has_child(ryml::to_csubstr("cooldown")))
+            {
+                int cooldown = 0;
+                node[ryml::to_csubstr("cooldown")] >> cooldown;
+                trigger.cooldown = std::chrono::seconds(std::max(cooldown, 0));
+            }
+            return true;
+        }
+    }
+
+    TriggerAutomaton::TriggerAutomaton(const std::vector<ChatTrigger>& triggers)
+    {
+        std::array<bool, 256> used{};
+        for (const auto& trigger : triggers)
+        {
+            for (const char c : trigger.pattern)
+            {
+                used[Fold(static_cast<unsigned char>(c))] = true;
+            }
+        }
+        std::array<std::uint8_t, 256> folded_classes{};
+        for (size_t b = 0; b < used.size(); ++b)
+        {
+            if (used[b] && class_count_ < 256)
+            {
+                folded_classes[b] = static_cast<std::uint8_t>(class_count_++);
+            }
+        }
+        for (size_t b = 0; b < byte_classes_.size(); ++b)
+        {
+            byte_classes_[b] = folded_classes[Fold(static_cast<unsigned char>(b))];
+        }
+
+        std::vector<std::vector<std::uint32_t>> state_outputs;
+        AddState();
+        state_outputs.emplace_back();
+        for (size_t i = 0; i < triggers.size(); ++i)
+        {
+            if (triggers[i].pattern.empty())
+            {
+                continue;
+            }
+
+            std::uint32_t state = 0;
+            for (const char c : triggers[i].pattern)
+            {
+                const size_t slot = state * class_count_ + byte_classes_[static_cast<unsigned char>(c)];
+                if (transitions_[slot] == kNoState)
+                {
+                    const std::uint32_t next = AddState();
+                    state_outputs.emplace_back();
+                    transitions_[slot] = next;
+                }
+                state = transitions_[slot];
+            }
+            state_outputs[state].push_back(static_cast<std::uint32_t>(i));
+        }
+
+        // Breadth-first pass computing failure links and completing the goto
+        // function into a full transition table.
+        const size_t state_count = state_outputs.size();
+        std::vector<std::uint32_t> failure(state_count, 0);
+        dictionary_links_.assign(state_count, kNoState);
+        std::vector<std::uint32_t> queue;
+        queue.reserve(state_count);
+        for (std::uint32_t c = 0; c < class_count_; ++c)
+        {
+            std::uint32_t& target = transitions_[c];
+            if (target == kNoState)
+            {
+                target = 0;
+            }
+            else
+            {
+                queue.push_back(target);
+            }
+        }
+
+        for (size_t head = 0; head < queue.size(); ++head)
+        {
+            const std::uint32_t state = queue[head];
+            const std::uint32_t fail = failure[state];
+            dictionary_links_[state] = state_outputs[fail].empty() ? dictionary_links_[fail] : fail;
+
+            for (std::uint32_t c = 0; c < class_count_; ++c)
+            {
+                std::uint32_t& target = transitions_[state * class_count_ + c];
+                const std::uint32_t fallback = transitions_[fail * class_count_ + c];
+                if (target == kNoState)
+                {
+                    target = fallback;
+                }
+                else
+                {
+                    failure[target] = fallback;
+                    queue.push_back(target);
+                }
+            }
+        }
+
+        output_begin_.reserve(state_count + 1);
+        for (const auto& own : state_outputs)
+        {
+            output_begin_.push_back(static_cast<std::uint32_t>(outputs_.size()));
+            outputs_.insert(outputs_.end(), own.begin(), own.end());
+        }
+        output_begin_.push_back(static_cast<std::uint32_t>(outputs_.size()));
+    }
+
+    std::uint32_t TriggerAutomaton::AddState()
+    {
+        const std::uint32_t state = static_cast<std::uint32_t>(transitions_.size() / class_count_);
+        transitions_.resize(transitions_.size() + class_count_, kNoState);
+        return state;
+    }
+
+    void TriggerAutomaton::Scan(const std::string_view text, std::vector<std::uint32_t>& matches) const
+    {
+        const size_t first = matches.size();
+        const std::uint32_t* table = transitions_.data();
+        const std::uint32_t* output_begin = output_begin_.data();
+        std::uint32_t state = 0;
+        for (const char c : text)
+        {
+            state = table[state * class_count_ + byte_classes_[static_cast<unsigned char>(c)]];
+            std::uint32_t hit = output_begin[state] != output_begin[state + 1] ? state : dictionary_links_[state];
+            while (hit != kNoState)
+            {
+                matches.insert(matches.end(), outputs_.begin() + output_begin[hit], outputs_.begin() + output_begin[hit + 1]);
+                hit = dictionary_links_[hit];
+            }
+        }
+
+        std::sort(matches.begin() + first, matches.end());
+        matches.erase(std::unique(matches.begin() + first, matches.end()), matches.end());
+    }
+
+    std::size_t TriggerAutomaton::GetStateCount() const
+    {
+        return output_begin_.empty() ? 0 : output_begin_.size() - 1;
+    }
+
+    std::size_t TriggerAutomaton::GetMemoryUsage() const
+    {
+        return (transitions_.size() + output_begin_.size() + outputs_.size() + dictionary_links_.size()) * sizeof(std::uint32_t)
+            + sizeof(byte_classes_);
+    }
+
+    bool ChatTriggers::LoadFromFile(const std::string& path, std::string* error)
+    {
+        std::ifstream file(path);
+        if (!file.is_open())
+        {
+            if (error)
+            {
+                *error = "Unable to open triggers file: " + path;
+            }
+            return false;
+        }
+
+        std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        file.close();
+
+        std::vector<ChatTrigger> loaded;
+        try
+        {
+            ryml::Tree tree = ryml::parse_in_arena(ryml::to_csubstr(path), ryml::to_csubstr(contents));
+            ryml::ConstNodeRef root = tree.rootref();
+            ryml::ConstNodeRef list_node = root;
+            if (root.has_child(ryml::to_csubstr("triggers")))
+            {
+                list_node = root[ryml::to_csubstr("triggers")];
+            }
+
+            if (list_node.readable())
+            {
+                if (!list_node.is_seq())
+                {
+                    if (error)
+                    {
+                        *error = "Triggers file must contain a sequence under \"triggers\".";
+                    }
+                    return false;
+                }
+
+                for (ryml::ConstNodeRef child : list_node.children())
+                {
+                    if (!child.readable())
+                    {
+                        continue;
+                    }
+                    ChatTrigger trigger;
+                    if (!ReadTrigger(child, trigger, error))
+                    {
+                        return false;
+                    }
+                    if (!trigger.pattern.empty())
+                    {
+                        loaded.push_back(std::move(trigger));
+                    }
+                }
+            }
+        }
+        catch (const std::exception& ex)
+        {
+            if (error)
+            {
+                *error = std::string("Failed to parse triggers file: ") + ex.what();
+            }
+            return false;
+        }
+
+        auto compiled = std::make_unique<Compiled>();
+        compiled->automaton = std::make_shared<const TriggerAutomaton>(loaded);
+        compiled->triggers = std::move(loaded);
+        std::lock_guard<std::mutex> lock(staged_mutex);
+        staged = std::move(compiled);
+        return true;
+    }
+
+    bool ChatTriggers::Commit()
+    {
+        std::unique_ptr<Compiled> compiled;
+        {
+            std::lock_guard<std::mutex> lock(staged_mutex);
+            compiled = std::move(staged);
+        }
+        if (!compiled)
+        {
+            return false;
+        }
+        automaton = std::move(compiled->automaton);
+        triggers = std::move(compiled->triggers);
+        last_fired.assign(triggers.size(), std::chrono::steady_clock::time_point{});
+        return true;
+    }
+
+    bool ChatTriggers::HasStaged() const
+    {
+        std::lock_guard<std::mutex> lock(staged_mutex);
+        return staged != nullptr;
+    }
+
+    bool ChatTriggers::IsEmpty() const
+    {
+        return triggers.empty();
+    }
+
+    std::size_t ChatTriggers::GetCount() const
+    {
+        return triggers.size();
+    }
+
+    std::string ChatTriggers::Describe() const
+    {
+        if (!automaton)
+        {
+            return "No triggers loaded.";
+        }
+        return std::to_string(triggers.size()) + " triggers, " + std::to_string(automaton->GetStateCount())
+            + " states, " + std::to_string(automaton->GetMemoryUsage() / 1024) + " KiB.";
+    }
+
+    std::vector<ChatTriggers::Hit> ChatTriggers::Match(const std::string_view text)
+    {
+        std::vector<Hit> hits;
+        if (!automaton || triggers.empty())
+        {
+            return hits;
+        }
+
+        scratch.clear();
+        automaton->Scan(text, scratch);
+        if (scratch.empty())
+        {
+            return hits;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        hits.reserve(scratch.size());
+        for (const std::uint32_t index : scratch)
+        {
+            Hit hit;
+            hit.trigger = &triggers[index];
+            const auto last = last_fired[index];
+            hit.cooling_down = last != std::chrono::steady_clock::time_point{} && now - last < triggers[index].cooldown;
+            if (!hit.cooling_down)
+            {
+                last_fired[index] = now;
+            }
+            hits.push_back(hit);
+        }
+        return hits;
+    }
+}
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <fstream>
 #include <string>
 
@@ -12,6 +13,10 @@ namespace absinthe
 {
     namespace
     {
+        constexpr const char* kBuiltinCommands[] = {
+            "help", "ping", "echo", "allow", "deny", "list", "remind", "search", "last", "triggers", "prof", "plugins", "audit"
+        };
+
         int HexValue(const char c)
         {
             if (c >= '0' && c <= '9')
@@ -30,79 +35,88 @@ namespace absinthe
         }
     }
 
-    bool ChatWhitelist::AddEntry(const std::string& entry)
+    ChatWhitelist::ChatWhitelist()
+        : roles(DefaultRoles())
     {
-        if (entry.empty())
+        for (const char* name : kBuiltinCommands)
         {
-            return false;
+            RegisterCommand(name);
         }
+    }
 
-        const std::optional<ProtocolCraft::UUID> uuid = ParseUuid(entry);
-        if (uuid.has_value())
+    std::map<std::string, ChatWhitelist::Role> ChatWhitelist::DefaultRoles()
+    {
+        std::map<std::string, Role> defaults;
+        defaults["admin"].commands = { "*" };
+        defaults["moderator"].commands = { "help", "ping", "echo", "list", "remind", "search", "last", "triggers", "prof" };
+        defaults["user"].commands = { "help", "ping", "echo", "remind" };
+        return defaults;
+    }
+
+    bool ChatWhitelist::AddEntry(const std::string& entry, const std::string& role)
+    {
+        if (entry.empty() || !HasRole(role))
         {
-            for (const auto& existing : allowed_uuids)
-            {
-                if (existing == uuid.value())
-                {
-                    return false;
-                }
-            }
-            allowed_uuids.push_back(uuid.value());
-            return true;
+            return false;
         }
 
-        const std::string normalized = NormalizeName(entry);
-        if (!normalized.empty())
+        auto it = FindEntry(entry);
+        if (it == entries.end())
         {
-            for (const auto& existing : allowed_names)
-            {
-                if (existing == normalized)
-                {
-                    return false;
-                }
-            }
-            allowed_names.push_back(normalized);
-            return true;
+            Entry added;
+            added.uuid = ParseUuid(entry);
+            added.key = added.uuid.has_value() ? FormatUuid(added.uuid.value()) : NormalizeName(entry);
+            entries.push_back(std::move(added));
+            it = entries.end() - 1;
+        }
+        else if (std::find(it->roles.begin(), it->roles.end(), role) != it->roles.end())
+        {
+            return false;
         }
-        return false;
+
+        it->roles.push_back(role);
+        UpdateMask(*it);
+        return true;
     }
 
-    bool ChatWhitelist::RemoveEntry(const std::string& entry)
+    bool ChatWhitelist::RemoveEntry(const std::string& entry, const std::string& role)
     {
         if (entry.empty())
         {
             return false;
         }
 
-        const std::optional<ProtocolCraft::UUID> uuid = ParseUuid(entry);
-        if (uuid.has_value())
+        const auto it = FindEntry(entry);
+        if (it == entries.end())
         {
-            const auto it = std::find(allowed_uuids.begin(), allowed_uuids.end(), uuid.value());
-            if (it != allowed_uuids.end())
-            {
-                allowed_uuids.erase(it);
-                return true;
-            }
             return false;
         }
 
-        const std::string normalized = NormalizeName(entry);
-        if (!normalized.empty())
+        if (!role.empty())
         {
-            const auto it = std::find(allowed_names.begin(), allowed_names.end(), normalized);
-            if (it != allowed_names.end())
+            const auto role_it = std::find(it->roles.begin(), it->roles.end(), role);
+            if (role_it == it->roles.end())
             {
-                allowed_names.erase(it);
-                return true;
+                return false;
             }
+            it->roles.erase(role_it);
+        }
+
+        if (role.empty() || it->roles.empty())
+        {
+            it->roles.clear();
+            UpdateMask(*it);
+            entries.erase(it);
+            return true;
         }
 
-        return false;
+        UpdateMask(*it);
+        return true;
     }
 
     bool ChatWhitelist::IsEmpty() const
     {
-        return allowed_uuids.empty() && allowed_names.empty();
+        return entries.empty();
     }
 
     bool ChatWhitelist::LoadFromFile(const std::string& path, std::string* error)
@@ -120,6 +134,10 @@ namespace absinthe
         std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
         file.close();
 
+        // Parse into a fresh allowlist so a bad file leaves this one untouched.
+        ChatWhitelist loaded;
+        loaded.command_names = command_names;
+        loaded.command_ids = command_ids;
         try
         {
             ryml::Tree tree = ryml::parse_in_arena(ryml::to_csubstr(path), ryml::to_csubstr(contents));
@@ -130,11 +148,53 @@ namespace absinthe
                 list_node = root[ryml::to_csubstr("whitelist")];
             }
 
-            allowed_uuids.clear();
-            allowed_names.clear();
+            if (root.is_map() && root.has_child(ryml::to_csubstr("roles")))
+            {
+                ryml::ConstNodeRef roles_node = root[ryml::to_csubstr("roles")];
+                if (!roles_node.is_map())
+                {
+                    if (error)
+                    {
+                        *error = "Whitelist \"roles\" must map role names to command lists.";
+                    }
+                    return false;
+                }
+                for (ryml::ConstNodeRef role_node : roles_node.children())
+                {
+                    std::string name;
+                    role_node >> ryml::key(name);
+                    if (!role_node.is_seq())
+                    {
+                        if (error)
+                        {
+                            *error = "Whitelist role \"" + name + "\" must be a list of commands.";
+                        }
+                        return false;
+                    }
+                    Role role;
+                    for (ryml::ConstNodeRef command_node : role_node.children())
+                    {
+                        std::string command;
+                        command_node >> command;
+                        if (command != "*" && !loaded.RegisterCommand(command).has_value())
+                        {
+                            if (error)
+                            {
+                                *error = "Too many distinct commands in whitelist roles (limit " + std::to_string(kMaxCommands) + ").";
+                            }
+                            return false;
+                        }
+                        role.commands.push_back(command);
+                    }
+                    loaded.roles[name] = std::move(role);
+                }
+                loaded.RebuildMasks();
+            }
 
-            if (!list_node.readable())
+            const bool has_list = !root.is_map() || root.has_child(ryml::to_csubstr("whitelist"));
+            if (!has_list || !list_node.readable())
             {
+                *this = std::move(loaded);
                 return true;
             }
 
@@ -147,6 +207,7 @@ namespace absinthe
                 return false;
             }
 
+            // Plain entries predate roles and keep their full access.
             for (ryml::ConstNodeRef child : list_node.children())
             {
                 if (!child.readable())
@@ -154,8 +215,48 @@ namespace absinthe
                     continue;
                 }
                 std::string entry;
-                child >> entry;
-                AddEntry(entry);
+                std::vector<std::string> entry_roles;
+                if (child.is_map())
+                {
+                    if (child.has_child(ryml::to_csubstr("player")))
+                    {
+                        child[ryml::to_csubstr("player")] >> entry;
+                    }
+                    if (child.has_child(ryml::to_csubstr("role")))
+                    {
+                        entry_roles.emplace_back();
+                        child[ryml::to_csubstr("role")] >> entry_roles.back();
+                    }
+                    if (child.has_child(ryml::to_csubstr("roles")))
+                    {
+                        for (ryml::ConstNodeRef role_node : child[ryml::to_csubstr("roles")].children())
+                        {
+                            entry_roles.emplace_back();
+                            role_node >> entry_roles.back();
+                        }
+                    }
+                }
+                else
+                {
+                    child >> entry;
+                }
+                if (entry_roles.empty())
+                {
+                    entry_roles.push_back(kDefaultRole);
+                }
+
+                for (const std::string& role : entry_roles)
+                {
+                    if (!loaded.HasRole(role))
+                    {
+                        if (error)
+                        {
+                            *error = "Whitelist entry \"" + entry + "\" uses undefined role \"" + role + "\".";
+                        }
+                        return false;
+                    }
+                    loaded.AddEntry(entry, role);
+                }
             }
         }
         catch (const std::exception& ex)
@@ -167,6 +268,7 @@ namespace absinthe
             return false;
         }
 
+        *this = std::move(loaded);
         return true;
     }
 
@@ -175,16 +277,40 @@ namespace absinthe
         ryml::Tree tree;
         ryml::NodeRef root = tree.rootref();
         root |= ryml::MAP;
-        ryml::NodeRef list_node = root[ryml::to_csubstr("whitelist")];
-        list_node |= ryml::SEQ;
 
-        for (const auto& name : allowed_names)
+        ryml::NodeRef roles_node = root[ryml::to_csubstr("roles")];
+        roles_node |= ryml::MAP;
+        for (const auto& [name, role] : roles)
         {
-            list_node.append_child() << name;
+            ryml::NodeRef role_node = roles_node.append_child();
+            role_node << ryml::key(name);
+            role_node |= ryml::SEQ;
+            for (const std::string& command : role.commands)
+            {
+                role_node.append_child() << command;
+            }
         }
-        for (const auto& uuid : allowed_uuids)
+
+        ryml::NodeRef list_node = root[ryml::to_csubstr("whitelist")];
+        list_node |= ryml::SEQ;
+        for (const Entry& entry : entries)
         {
-            list_node.append_child() << FormatUuid(uuid);
+            // Admin-only entries keep the plain pre-roles form.
+            if (entry.roles.size() == 1 && entry.roles.front() == kDefaultRole)
+            {
+                list_node.append_child() << entry.key;
+                continue;
+            }
+
+            ryml::NodeRef entry_node = list_node.append_child();
+            entry_node |= ryml::MAP;
+            entry_node[ryml::to_csubstr("player")] << entry.key;
+            ryml::NodeRef entry_roles = entry_node[ryml::to_csubstr("roles")];
+            entry_roles |= ryml::SEQ;
+            for (const std::string& role : entry.roles)
+            {
+                entry_roles.append_child() << role;
+            }
         }
 
         std::string output = ryml::emitrs_yaml<std::string>(tree);
@@ -209,31 +335,112 @@ namespace absinthe
         return true;
     }
 
-    bool ChatWhitelist::IsAllowed(const ChatMessage& message) const
+    std::uint64_t ChatWhitelist::GetPermissions(const ChatMessage& message)
     {
-        if (IsEmpty())
+        const auto sender_it = sender_masks.find(message.sender);
+        if (sender_it != sender_masks.end())
         {
-            return false;
+            return sender_it->second;
         }
 
-        for (const auto& allowed_uuid : allowed_uuids)
+        // A player may be listed by UUID and by name with different roles.
+        std::uint64_t permissions = 0;
+        const auto uuid_it = uuid_masks.find(message.sender);
+        if (uuid_it != uuid_masks.end())
         {
-            if (allowed_uuid == message.sender)
+            permissions = uuid_it->second;
+        }
+        if (!name_masks.empty())
+        {
+            const auto name_it = name_masks.find(NormalizeName(message.sender_name));
+            if (name_it != name_masks.end())
             {
-                return true;
+                permissions |= name_it->second;
             }
         }
 
-        const std::string normalized = NormalizeName(message.sender_name);
-        for (const auto& allowed_name : allowed_names)
+        if (sender_masks.size() >= kMaxSenders)
         {
-            if (allowed_name == normalized)
+            sender_masks.clear();
+        }
+        sender_masks.emplace(message.sender, permissions);
+        return permissions;
+    }
+
+    bool ChatWhitelist::Permits(const std::uint64_t permissions, const std::optional<std::size_t>& command_id)
+    {
+        // A command without an id has no bit any role could grant.
+        return command_id.has_value() && ((permissions >> command_id.value()) & 1u);
+    }
+
+    bool ChatWhitelist::IsBuiltinCommand(const std::string& name)
+    {
+        return std::any_of(std::begin(kBuiltinCommands), std::end(kBuiltinCommands),
+            [&](const char* builtin) { return name == builtin; });
+    }
+
+    bool ChatWhitelist::HasRole(const std::string& role) const
+    {
+        return roles.find(role) != roles.end();
+    }
+
+    std::optional<std::size_t> ChatWhitelist::FindCommand(const std::string& name) const
+    {
+        const auto it = command_ids.find(name);
+        if (it == command_ids.end())
+        {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    std::optional<std::size_t> ChatWhitelist::RegisterCommand(const std::string& name)
+    {
+        const std::optional<std::size_t> existing = FindCommand(name);
+        if (existing.has_value() || name.empty())
+        {
+            return existing;
+        }
+
+        // Slots freed by unloaded plugins are reused first.
+        const auto free_slot = std::find(command_names.begin(), command_names.end(), std::string());
+        if (free_slot == command_names.end() && command_names.size() >= kMaxCommands)
+        {
+            return std::nullopt;
+        }
+        const std::size_t id = static_cast<std::size_t>(free_slot - command_names.begin());
+        if (free_slot == command_names.end())
+        {
+            command_names.push_back(name);
+        }
+        else
+        {
+            *free_slot = name;
+        }
+        command_ids.emplace(name, id);
+        // Roles may already name the command, e.g. a plugin loaded after the allowlist.
+        RebuildMasks();
+        return id;
+    }
+
+    bool ChatWhitelist::UnregisterCommand(const std::string& name)
+    {
+        const auto it = command_ids.find(name);
+        if (it == command_ids.end() || IsBuiltinCommand(name))
+        {
+            return false;
+        }
+        for (const auto& [role_name, role] : roles)
+        {
+            if (std::find(role.commands.begin(), role.commands.end(), name) != role.commands.end())
             {
-                return true;
+                return false;
             }
         }
 
-        return false;
+        command_names[it->second].clear();
+        command_ids.erase(it);
+        return true;
     }
 
     std::string ChatWhitelist::FormatEntries() const
@@ -245,25 +452,110 @@ namespace absinthe
 
         std::string output = "Allowlist: ";
         bool first = true;
-        for (const auto& name : allowed_names)
+        for (const Entry& entry : entries)
         {
             if (!first)
             {
                 output += ", ";
             }
-            output += name;
+            output += entry.key;
+            if (entry.roles.size() != 1 || entry.roles.front() != kDefaultRole)
+            {
+                output += " (";
+                for (size_t i = 0; i < entry.roles.size(); ++i)
+                {
+                    output += (i > 0 ? "+" : "") + entry.roles[i];
+                }
+                output += ")";
+            }
             first = false;
         }
-        for (const auto& uuid : allowed_uuids)
+        return output;
+    }
+
+    std::size_t ChatWhitelist::UuidHash::operator()(const ProtocolCraft::UUID& uuid) const
+    {
+        std::uint64_t high = 0;
+        std::uint64_t low = 0;
+        std::memcpy(&high, uuid.data(), sizeof(high));
+        std::memcpy(&low, uuid.data() + sizeof(high), sizeof(low));
+        return static_cast<std::size_t>(high ^ (low * 0x9E3779B97F4A7C15ull));
+    }
+
+    std::vector<ChatWhitelist::Entry>::iterator ChatWhitelist::FindEntry(const std::string& entry)
+    {
+        const std::optional<ProtocolCraft::UUID> uuid = ParseUuid(entry);
+        const std::string key = uuid.has_value() ? FormatUuid(uuid.value()) : NormalizeName(entry);
+        return std::find_if(entries.begin(), entries.end(), [&key](const Entry& existing) {
+            return existing.key == key;
+        });
+    }
+
+    std::uint64_t ChatWhitelist::CompileRole(const Role& role) const
+    {
+        std::uint64_t mask = 0;
+        for (const std::string& command : role.commands)
+        {
+            if (command == "*")
+            {
+                return ~std::uint64_t{ 0 };
+            }
+            const auto it = command_ids.find(command);
+            if (it != command_ids.end())
+            {
+                mask |= std::uint64_t{ 1 } << it->second;
+            }
+        }
+        return mask;
+    }
+
+    void ChatWhitelist::UpdateMask(const Entry& entry)
+    {
+        sender_masks.clear();
+        std::uint64_t mask = 0;
+        for (const std::string& role : entry.roles)
         {
-            if (!first)
+            const auto it = roles.find(role);
+            if (it != roles.end())
             {
-                output += ", ";
+                mask |= it->second.mask;
             }
-            output += FormatUuid(uuid);
-            first = false;
         }
-        return output;
+
+        if (entry.uuid.has_value())
+        {
+            if (entry.roles.empty())
+            {
+                uuid_masks.erase(entry.uuid.value());
+            }
+            else
+            {
+                uuid_masks[entry.uuid.value()] = mask;
+            }
+        }
+        else if (entry.roles.empty())
+        {
+            name_masks.erase(entry.key);
+        }
+        else
+        {
+            name_masks[entry.key] = mask;
+        }
+    }
+
+    void ChatWhitelist::RebuildMasks()
+    {
+        for (auto& [name, role] : roles)
+        {
+            role.mask = CompileRole(role);
+        }
+        uuid_masks.clear();
+        name_masks.clear();
+        sender_masks.clear();
+        for (const Entry& entry : entries)
+        {
+            UpdateMask(entry);
+        }
     }
 
     std::optional<ProtocolCraft::UUID> ChatWhitelist::ParseUuid(const std::string& value)
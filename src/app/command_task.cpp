@@ -0,0 +1,388 @@
+#include "absinthe/command_task.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <new>
+
+#include "botcraft/Utilities/Logger.hpp"
+
+namespace absinthe
+{
+    namespace
+    {
+        constexpr std::size_t kFrameGranularity = 64;
+        constexpr std::size_t kFrameClasses = 32;
+
+        struct FreeFrame
+        {
+            FreeFrame* next;
+        };
+
+        struct FrameFreeLists
+        {
+            std::array<FreeFrame*, kFrameClasses> heads{};
+
+            ~FrameFreeLists()
+            {
+                for (FreeFrame*& head : heads)
+                {
+                    while (head)
+                    {
+                        FreeFrame* next = head->next;
+                        ::operator delete(head);
+                        head = next;
+                    }
+                }
+            }
+        };
+
+        thread_local FrameFreeLists frame_free_lists;
+
+        std::size_t FrameClass(const std::size_t size)
+        {
+            return (size + kFrameGranularity - 1) / kFrameGranularity - 1;
+        }
+
+        bool MatchesReply(const std::string_view expected, const std::string_view content)
+        {
+            size_t begin = 0;
+            size_t end = content.size();
+            while (begin < end && std::isspace(static_cast<unsigned char>(content[begin])))
+            {
+                ++begin;
+            }
+            while (end > begin && std::isspace(static_cast<unsigned char>(content[end - 1])))
+            {
+                --end;
+            }
+            if (end - begin != expected.size())
+            {
+                return false;
+            }
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                if (std::tolower(static_cast<unsigned char>(content[begin + i])) != std::tolower(static_cast<unsigned char>(expected[i])))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void RemoveWaiter(std::vector<CommandScheduler::Waiter*>& waiters, const CommandScheduler::Waiter* waiter)
+        {
+            const auto it = std::find(waiters.begin(), waiters.end(), waiter);
+            if (it != waiters.end())
+            {
+                *it = waiters.back();
+                waiters.pop_back();
+            }
+        }
+    }
+
+    void* FramePool::Allocate(const std::size_t size)
+    {
+        const std::size_t size_class = FrameClass(size);
+        if (size_class >= kFrameClasses)
+        {
+            return ::operator new(size);
+        }
+
+        FreeFrame*& head = frame_free_lists.heads[size_class];
+        if (head)
+        {
+            FreeFrame* frame = head;
+            head = frame->next;
+            return frame;
+        }
+        return ::operator new((size_class + 1) * kFrameGranularity);
+    }
+
+    void FramePool::Deallocate(void* ptr, const std::size_t size) noexcept
+    {
+        const std::size_t size_class = FrameClass(size);
+        if (size_class >= kFrameClasses)
+        {
+            ::operator delete(ptr);
+            return;
+        }
+
+        FreeFrame* frame = static_cast<FreeFrame*>(ptr);
+        frame->next = frame_free_lists.heads[size_class];
+        frame_free_lists.heads[size_class] = frame;
+    }
+
+    CommandTask CommandTask::promise_type::get_return_object() noexcept
+    {
+        return CommandTask(Handle::from_promise(*this));
+    }
+
+    CommandTask::CommandTask(Handle handle)
+        : handle_(handle)
+    {
+    }
+
+    CommandTask::CommandTask(CommandTask&& other) noexcept
+        : handle_(other.Release())
+    {
+    }
+
+    CommandTask& CommandTask::operator=(CommandTask&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle_)
+            {
+                handle_.destroy();
+            }
+            handle_ = other.Release();
+        }
+        return *this;
+    }
+
+    CommandTask::~CommandTask()
+    {
+        if (handle_)
+        {
+            handle_.destroy();
+        }
+    }
+
+    CommandTask::Handle CommandTask::Release() noexcept
+    {
+        Handle handle = handle_;
+        handle_ = nullptr;
+        return handle;
+    }
+
+    CommandScheduler::TickAwaiter::TickAwaiter(CommandScheduler& scheduler)
+    {
+        waiter_.scheduler = &scheduler;
+        waiter_.kind = WaitKind::Tick;
+    }
+
+    void CommandScheduler::TickAwaiter::await_suspend(std::coroutine_handle<> handle)
+    {
+        waiter_.handle = handle;
+        waiter_.scheduler->Park(waiter_);
+    }
+
+    CommandScheduler::TimerAwaiter::TimerAwaiter(CommandScheduler& scheduler, const Clock::duration delay)
+    {
+        waiter_.scheduler = &scheduler;
+        waiter_.kind = WaitKind::Timer;
+        waiter_.deadline = Clock::now() + delay;
+    }
+
+    bool CommandScheduler::TimerAwaiter::await_ready() const noexcept
+    {
+        return waiter_.deadline <= Clock::now();
+    }
+
+    void CommandScheduler::TimerAwaiter::await_suspend(std::coroutine_handle<> handle)
+    {
+        waiter_.handle = handle;
+        waiter_.scheduler->Park(waiter_);
+    }
+
+    CommandScheduler::ChatAwaiter::ChatAwaiter(CommandScheduler& scheduler, const ProtocolCraft::UUID& sender, const std::string_view reply,
+        const Clock::duration timeout)
+    {
+        waiter_.scheduler = &scheduler;
+        waiter_.kind = WaitKind::Chat;
+        waiter_.sender = sender;
+        waiter_.reply = reply;
+        waiter_.deadline = Clock::now() + timeout;
+    }
+
+    void CommandScheduler::ChatAwaiter::await_suspend(std::coroutine_handle<> handle)
+    {
+        waiter_.handle = handle;
+        waiter_.scheduler->Park(waiter_);
+    }
+
+    CommandScheduler::CommandScheduler(const std::size_t capacity)
+    {
+        tasks_.reserve(capacity);
+        tick_waiters_.reserve(capacity);
+        timed_waiters_.reserve(capacity);
+        chat_waiters_.reserve(capacity);
+        ready_.reserve(capacity);
+    }
+
+    CommandScheduler::~CommandScheduler()
+    {
+        CancelAll();
+    }
+
+    void CommandScheduler::CancelAll()
+    {
+        tick_waiters_.clear();
+        timed_waiters_.clear();
+        chat_waiters_.clear();
+        ready_.clear();
+        cancelling_ = true;
+        std::vector<std::coroutine_handle<>> tasks;
+        tasks.swap(tasks_);
+        for (std::coroutine_handle<> task : tasks)
+        {
+            task.destroy();
+        }
+        cancelling_ = false;
+    }
+
+    void CommandScheduler::Spawn(CommandTask task)
+    {
+        const std::coroutine_handle<> handle = task.Release();
+        if (!handle)
+        {
+            return;
+        }
+        tasks_.push_back(handle);
+        Resume(handle);
+    }
+
+    bool CommandScheduler::DispatchChat(ChatMessage& message)
+    {
+        for (Waiter* waiter : chat_waiters_)
+        {
+            if (waiter->sender != message.sender || !MatchesReply(waiter->reply, message.content))
+            {
+                continue;
+            }
+
+            waiter->message.emplace(std::move(message));
+            Unpark(*waiter);
+            ready_.push_back(waiter->handle);
+            ResumeReady();
+            return true;
+        }
+        return false;
+    }
+
+    void CommandScheduler::Tick()
+    {
+        for (Waiter* waiter : tick_waiters_)
+        {
+            ready_.push_back(waiter->handle);
+        }
+        tick_waiters_.clear();
+
+        const Clock::time_point now = Clock::now();
+        for (size_t i = 0; i < timed_waiters_.size();)
+        {
+            Waiter* waiter = timed_waiters_[i];
+            if (waiter->deadline > now)
+            {
+                ++i;
+                continue;
+            }
+
+            Unpark(*waiter);
+            ready_.push_back(waiter->handle);
+        }
+
+        ResumeReady();
+    }
+
+    CommandScheduler::TickAwaiter CommandScheduler::NextTick()
+    {
+        return TickAwaiter(*this);
+    }
+
+    CommandScheduler::TimerAwaiter CommandScheduler::SleepFor(const Clock::duration delay)
+    {
+        return TimerAwaiter(*this, delay);
+    }
+
+    CommandScheduler::ChatAwaiter CommandScheduler::NextChat(const ProtocolCraft::UUID& sender, const std::string_view reply,
+        const Clock::duration timeout)
+    {
+        return ChatAwaiter(*this, sender, reply, timeout);
+    }
+
+    void CommandScheduler::Park(Waiter& waiter)
+    {
+        switch (waiter.kind)
+        {
+        case WaitKind::Tick:
+            tick_waiters_.push_back(&waiter);
+            return;
+        case WaitKind::Timer:
+            timed_waiters_.push_back(&waiter);
+            return;
+        case WaitKind::Chat:
+            chat_waiters_.push_back(&waiter);
+            timed_waiters_.push_back(&waiter);
+            return;
+        }
+    }
+
+    void CommandScheduler::Unpark(Waiter& waiter)
+    {
+        switch (waiter.kind)
+        {
+        case WaitKind::Tick:
+            RemoveWaiter(tick_waiters_, &waiter);
+            return;
+        case WaitKind::Timer:
+            RemoveWaiter(timed_waiters_, &waiter);
+            return;
+        case WaitKind::Chat:
+            RemoveWaiter(chat_waiters_, &waiter);
+            RemoveWaiter(timed_waiters_, &waiter);
+            return;
+        }
+    }
+
+    void CommandScheduler::Resume(std::coroutine_handle<> handle)
+    {
+        handle.resume();
+        if (!handle.done())
+        {
+            return;
+        }
+
+        const CommandTask::Handle task = CommandTask::Handle::from_address(handle.address());
+        if (task.promise().exception)
+        {
+            try
+            {
+                std::rethrow_exception(task.promise().exception);
+            }
+            catch (const std::exception& ex)
+            {
+                LOG_ERROR("Command handler failed: " << ex.what());
+            }
+            catch (...)
+            {
+                LOG_ERROR("Command handler failed with an unknown exception");
+            }
+        }
+
+        const auto it = std::find(tasks_.begin(), tasks_.end(), handle);
+        if (it != tasks_.end())
+        {
+            *it = tasks_.back();
+            tasks_.pop_back();
+        }
+        handle.destroy();
+    }
+
+    void CommandScheduler::ResumeReady()
+    {
+        if (resuming_)
+        {
+            return;
+        }
+
+        resuming_ = true;
+        for (size_t i = 0; i < ready_.size(); ++i)
+        {
+            Resume(ready_[i]);
+        }
+        ready_.clear();
+        resuming_ = false;
+    }
+}
@@ -0,0 +1,388 @@
+#include "absinthe/control_socket.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "botcraft/Utilities/Logger.hpp"
+#include "absinthe/trace.hpp"
+
+namespace absinthe
+{
+    namespace
+    {
+        constexpr std::size_t kMaxClients = 256;
+        constexpr std::size_t kMaxLineLength = 4096;
+        constexpr std::size_t kMaxPendingOutput = 1 << 20;
+        // Requests answered per Poll across all clients, so a client pipelining
+        // thousands of lines cannot stall the chat tick.
+        constexpr std::size_t kMaxRequestsPerPoll = 64;
+
+        void AppendJsonString(std::string& out, const std::string& value)
+        {
+            static constexpr char kHex[] = "0123456789abcdef";
+            out.push_back('"');
+            for (const char c : value)
+            {
+                switch (c)
+                {
+                case '"':
+                    out += "\\\"";
+                    break;
+                case '\\':
+                    out += "\\\\";
+                    break;
+                case '\n':
+                    out += "\\n";
+                    break;
+                case '\r':
+                    out += "\\r";
+                    break;
+                case '\t':
+                    out += "\\t";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                    {
+                        out += "\\u00";
+                        out.push_back(kHex[(c >> 4) & 0xF]);
+                        out.push_back(kHex[c & 0xF]);
+                    }
+                    else
+                    {
+                        out.push_back(c);
+                    }
+                    break;
+                }
+            }
+            out.push_back('"');
+        }
+    }
+
+    ControlSocket::~ControlSocket()
+    {
+        Close();
+    }
+
+    bool ControlSocket::Open(const std::string& path, std::string* error)
+    {
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            if (error)
+            {
+                *error = "Control socket path is too long: " + path;
+            }
+            return false;
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0)
+        {
+            if (error)
+            {
+                *error = std::string("Unable to create control socket: ") + std::strerror(errno);
+            }
+            return false;
+        }
+
+        // A socket file left behind by a previous run would make bind fail;
+        // anything else at that path is left alone.
+        struct stat existing{};
+        if (lstat(path.c_str(), &existing) == 0)
+        {
+            if (!S_ISSOCK(existing.st_mode))
+            {
+                if (error)
+                {
+                    *error = "Control socket path exists and is not a socket: " + path;
+                }
+                close(listen_fd_);
+                listen_fd_ = -1;
+                return false;
+            }
+            unlink(path.c_str());
+        }
+        const mode_t previous_mask = umask(0077);
+        const bool bound = bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        umask(previous_mask);
+        if (!bound || listen(listen_fd_, 64) != 0)
+        {
+            if (error)
+            {
+                *error = "Unable to listen on control socket " + path + ": " + std::strerror(errno);
+            }
+            close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+
+        path_ = path;
+        connections_.reserve(kMaxClients);
+        poll_fds_.reserve(kMaxClients + 1);
+        return true;
+    }
+
+    void ControlSocket::Close()
+    {
+        for (Connection& connection : connections_)
+        {
+            close(connection.fd);
+        }
+        connections_.clear();
+        if (listen_fd_ >= 0)
+        {
+            close(listen_fd_);
+            listen_fd_ = -1;
+            unlink(path_.c_str());
+        }
+    }
+
+    void ControlSocket::Poll(const Handler& handler)
+    {
+        if (listen_fd_ < 0)
+        {
+            return;
+        }
+
+        poll_fds_.clear();
+        poll_fds_.push_back(pollfd{ listen_fd_, POLLIN, 0 });
+        bool backlog = false;
+        for (const Connection& connection : connections_)
+        {
+            // A client with unanswered lines is not read from until they are
+            // handled.
+            const short events = static_cast<short>((connection.backlog ? 0 : POLLIN) | (connection.output.empty() ? 0 : POLLOUT));
+            poll_fds_.push_back(pollfd{ connection.fd, events, 0 });
+            backlog = backlog || connection.backlog;
+        }
+        if (poll(poll_fds_.data(), poll_fds_.size(), 0) <= 0 && !backlog)
+        {
+            return;
+        }
+
+        ABSINTHE_TRACE_SPAN("control socket");
+        const size_t polled = connections_.size();
+        std::size_t budget = kMaxRequestsPerPoll;
+        for (size_t n = 0; n < polled; ++n)
+        {
+            // Start after the client served first last time so a busy one
+            // cannot take the whole budget every tick.
+            const size_t i = (next_reader_ + n) % polled;
+            Connection& connection = connections_[i];
+            const bool readable = !connection.backlog && (poll_fds_[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+            if (readable)
+            {
+                Read(connection);
+            }
+            if (readable || connection.backlog)
+            {
+                HandleLines(connection, handler, budget);
+            }
+        }
+        next_reader_ = polled == 0 ? 0 : (next_reader_ + 1) % polled;
+        if ((poll_fds_[0].revents & POLLIN) != 0)
+        {
+            Accept();
+        }
+
+        for (Connection& connection : connections_)
+        {
+            Flush(connection);
+        }
+        connections_.erase(std::remove_if(connections_.begin(), connections_.end(), [](const Connection& connection) {
+            const bool done = connection.failed || (connection.eof && !connection.backlog && connection.output.empty());
+            if (done)
+            {
+                close(connection.fd);
+            }
+            return done;
+        }), connections_.end());
+    }
+
+    void ControlSocket::Complete(ControlRequest& request)
+    {
+        request.completed = true;
+        std::string line = "{\"id\":" + std::to_string(request.id) + ",\"ok\":" + (request.ok ? "true" : "false") + ",\"replies\":[";
+        for (size_t i = 0; i < request.replies.size(); ++i)
+        {
+            if (i > 0)
+            {
+                line.push_back(',');
+            }
+            AppendJsonString(line, request.replies[i]);
+        }
+        line += "]}\n";
+        request.replies.clear();
+        Queue(request.connection, line);
+    }
+
+    void ControlSocket::SendLate(const ControlRequest& request, const std::string& text)
+    {
+        std::string line = "{\"id\":" + std::to_string(request.id) + ",\"reply\":";
+        AppendJsonString(line, text);
+        line += "}\n";
+        Queue(request.connection, line);
+        for (Connection& connection : connections_)
+        {
+            if (connection.id == request.connection)
+            {
+                Flush(connection);
+            }
+        }
+    }
+
+    std::size_t ControlSocket::GetClientCount() const
+    {
+        return connections_.size();
+    }
+
+    void ControlSocket::Accept()
+    {
+        while (true)
+        {
+            const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                {
+                    LOG_WARNING("Control socket accept failed: " << std::strerror(errno));
+                }
+                return;
+            }
+            if (connections_.size() >= kMaxClients)
+            {
+                static constexpr char kBusy[] = "{\"id\":0,\"ok\":false,\"replies\":[\"Too many control clients.\"]}\n";
+                send(fd, kBusy, sizeof(kBusy) - 1, MSG_NOSIGNAL);
+                close(fd);
+                continue;
+            }
+
+            Connection connection;
+            connection.fd = fd;
+            connection.id = next_connection_++;
+            connections_.push_back(std::move(connection));
+        }
+    }
+
+    void ControlSocket::Read(Connection& connection)
+    {
+        char buffer[4096];
+        while (!connection.eof && !connection.failed)
+        {
+            const ssize_t received = recv(connection.fd, buffer, sizeof(buffer), 0);
+            if (received > 0)
+            {
+                connection.input.append(buffer, static_cast<size_t>(received));
+                continue;
+            }
+            if (received == 0)
+            {
+                connection.eof = true;
+            }
+            else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                connection.failed = true;
+            }
+            break;
+        }
+    }
+
+    void ControlSocket::HandleLines(Connection& connection, const Handler& handler, std::size_t& budget)
+    {
+        // The connection may hold several pipelined requests; answer complete
+        // lines in order while the budget lasts and keep the rest for the
+        // next Poll. A trailing line without a newline waits for more data
+        // unless the peer has closed its side.
+        size_t start = 0;
+        connection.backlog = false;
+        while (!connection.failed)
+        {
+            size_t end = connection.input.find('\n', start);
+            if (end == std::string::npos)
+            {
+                if (!connection.eof || start == connection.input.size())
+                {
+                    break;
+                }
+                end = connection.input.size();
+            }
+            if (budget == 0)
+            {
+                connection.backlog = true;
+                break;
+            }
+
+            std::string line = connection.input.substr(start, end - start);
+            start = std::min(end + 1, connection.input.size());
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+            if (line.empty())
+            {
+                continue;
+            }
+
+            --budget;
+            auto request = std::make_shared<ControlRequest>();
+            request->connection = connection.id;
+            request->id = connection.next_request++;
+            handler(request, line);
+            if (!request->completed)
+            {
+                Complete(*request);
+            }
+        }
+        connection.input.erase(0, start);
+
+        if (!connection.backlog && connection.input.size() > kMaxLineLength)
+        {
+            LOG_WARNING("Dropping control client " << connection.id << ": request line longer than " << kMaxLineLength << " bytes");
+            connection.failed = true;
+        }
+    }
+
+    void ControlSocket::Flush(Connection& connection)
+    {
+        while (!connection.output.empty() && !connection.failed)
+        {
+            const ssize_t sent = send(connection.fd, connection.output.data(), connection.output.size(), MSG_NOSIGNAL);
+            if (sent > 0)
+            {
+                connection.output.erase(0, static_cast<size_t>(sent));
+                continue;
+            }
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            {
+                return;
+            }
+            connection.failed = true;
+        }
+    }
+
+    void ControlSocket::Queue(const std::uint64_t connection_id, const std::string& line)
+    {
+        for (Connection& connection : connections_)
+        {
+            if (connection.id != connection_id)
+            {
+                continue;
+            }
+            connection.output += line;
+            if (connection.output.size() > kMaxPendingOutput)
+            {
+                LOG_WARNING("Dropping control client " << connection.id << ": not reading its responses");
+                connection.failed = true;
+            }
+            return;
+        }
+    }
+}
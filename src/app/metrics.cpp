@@ -0,0 +1,142 @@
+#include "absinthe/metrics.hpp"
+#include "absinthe/thread_layout.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#include "botcraft/Utilities/Logger.hpp"
+
+namespace absinthe
+{
+    Metrics& Metrics::GetInstance()
+    {
+        static Metrics instance;
+        return instance;
+    }
+
+    void Metrics::Set(const std::string& name, const double value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        values[name] = value;
+    }
+
+    void Metrics::Add(const std::string& name, const double delta)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        values[name] += delta;
+    }
+
+    double Metrics::Get(const std::string& name) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto it = values.find(name);
+        return it == values.end() ? 0.0 : it->second;
+    }
+
+    std::string Metrics::Format() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string output;
+        for (const auto& [name, value] : values)
+        {
+            char line[32];
+            std::snprintf(line, sizeof(line), " %.17g\n", value);
+            output += name;
+            output += line;
+        }
+        return output;
+    }
+
+    void Metrics::StartExport(const std::string& path, const std::chrono::milliseconds interval)
+    {
+        StopExport();
+        {
+            std::lock_guard<std::mutex> lock(export_mutex);
+            export_path = path;
+            export_interval = interval;
+            export_stopping = false;
+        }
+        export_thread = std::thread(&Metrics::ExportLoop, this);
+    }
+
+    void Metrics::StopExport()
+    {
+        if (!export_thread.joinable())
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(export_mutex);
+            export_stopping = true;
+        }
+        export_wake.notify_all();
+        export_thread.join();
+        Export();
+    }
+
+    void Metrics::ExportLoop()
+    {
+        ThreadLayout::GetInstance().ApplyToCurrentThread(ThreadRole::Persistence, "metrics");
+        std::unique_lock<std::mutex> lock(export_mutex);
+        while (!export_wake.wait_for(lock, export_interval, [this]() { return export_stopping; }))
+        {
+            lock.unlock();
+            Export();
+            lock.lock();
+        }
+    }
+
+    void Metrics::Export()
+    {
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(export_mutex);
+            path = export_path;
+        }
+
+        std::string error;
+        if (!path.empty() && !WriteTextfile(path, &error))
+        {
+            LOG_WARNING(error);
+        }
+    }
+
+    bool Metrics::WriteTextfile(const std::string& path, std::string* error) const
+    {
+        // Write next to the target and rename so scrapers never see a partial file.
+        const std::string temp_path = path + ".tmp";
+        {
+            std::ofstream file(temp_path, std::ios::trunc);
+            if (!file.is_open())
+            {
+                if (error)
+                {
+                    *error = "Unable to write metrics file: " + temp_path;
+                }
+                return false;
+            }
+            file << Format();
+            if (!file.good())
+            {
+                if (error)
+                {
+                    *error = "Failed while writing metrics file: " + temp_path;
+                }
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(temp_path, path, ec);
+        if (ec)
+        {
+            if (error)
+            {
+                *error = "Unable to replace metrics file " + path + ": " + ec.message();
+            }
+            return false;
+        }
+        return true;
+    }
+}
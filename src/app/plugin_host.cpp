@@ -0,0 +1,324 @@
+#include "absinthe/plugin_host.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <sstream>
+#include <system_error>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "botcraft/Utilities/Logger.hpp"
+
+namespace absinthe
+{
+    namespace
+    {
+        void ForwardReply(void* context, const char* text, const size_t length)
+        {
+            if (text != nullptr)
+            {
+                (*static_cast<const PluginHost::ReplyFn*>(context))(std::string_view(text, length));
+            }
+        }
+
+        void SetError(std::string* error, const std::string& message)
+        {
+            if (error)
+            {
+                *error = message;
+            }
+        }
+
+        bool WriteAll(const int fd, const char* data, std::size_t size)
+        {
+            while (size > 0)
+            {
+                const ssize_t written = write(fd, data, size);
+                if (written < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (written <= 0)
+                {
+                    return false;
+                }
+                data += written;
+                size -= static_cast<std::size_t>(written);
+            }
+            return true;
+        }
+
+        // Copies the file into an anonymous memory file, so no path another
+        // user could swap out is ever handed to dlopen. Returns -1 with errno
+        // set on failure.
+        int CopyToMemoryFile(const std::filesystem::path& source)
+        {
+            const int input = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+            if (input < 0)
+            {
+                return -1;
+            }
+            int output = memfd_create(("absinthe-plugin-" + source.filename().string()).c_str(), MFD_CLOEXEC);
+            char buffer[64 * 1024];
+            while (output >= 0)
+            {
+                const ssize_t received = read(input, buffer, sizeof(buffer));
+                if (received == 0)
+                {
+                    break;
+                }
+                if (received < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (received < 0 || !WriteAll(output, buffer, static_cast<std::size_t>(received)))
+                {
+                    const int saved = errno;
+                    close(output);
+                    output = -1;
+                    errno = saved;
+                }
+            }
+            const int saved = errno;
+            close(input);
+            errno = saved;
+            return output;
+        }
+    }
+
+    struct PluginHost::Library
+    {
+        std::string name;
+        void* handle = nullptr;
+        const absinthe_plugin* plugin = nullptr;
+
+        ~Library()
+        {
+            if (plugin != nullptr && plugin->shutdown != nullptr)
+            {
+                plugin->shutdown(plugin->user_data);
+            }
+            if (handle != nullptr)
+            {
+                dlclose(handle);
+            }
+        }
+    };
+
+    std::shared_ptr<PluginHost::Library> PluginHost::OpenLibrary(const std::string& path, std::string* error)
+    {
+        // dlopen returns the already loaded image for a file it has seen, so
+        // each load goes through a fresh memory file; once mapped, the
+        // descriptor is no longer needed.
+        const std::filesystem::path source(path);
+        const int fd = CopyToMemoryFile(source);
+        if (fd < 0)
+        {
+            SetError(error, "Unable to stage plugin " + path + ": " + std::strerror(errno));
+            return nullptr;
+        }
+
+        auto library = std::make_shared<Library>();
+        library->name = source.stem().string();
+        library->handle = dlopen(("/proc/self/fd/" + std::to_string(fd)).c_str(), RTLD_NOW | RTLD_LOCAL);
+        close(fd);
+        if (library->handle == nullptr)
+        {
+            const char* reason = dlerror();
+            SetError(error, "Unable to load plugin " + path + ": " + (reason ? reason : "unknown error"));
+            return nullptr;
+        }
+
+        const auto init = reinterpret_cast<absinthe_plugin_init_fn>(dlsym(library->handle, ABSINTHE_PLUGIN_INIT_SYMBOL));
+        if (init == nullptr)
+        {
+            SetError(error, "Plugin " + path + " does not export " ABSINTHE_PLUGIN_INIT_SYMBOL ".");
+            return nullptr;
+        }
+
+        const absinthe_plugin* plugin = init();
+        if (plugin == nullptr)
+        {
+            SetError(error, "Plugin " + path + " failed to initialize.");
+            return nullptr;
+        }
+        if (plugin->abi_version != ABSINTHE_PLUGIN_ABI_VERSION)
+        {
+            SetError(error, "Plugin " + path + " was built for ABI version " + std::to_string(plugin->abi_version)
+                + ", expected " + std::to_string(ABSINTHE_PLUGIN_ABI_VERSION) + ".");
+            return nullptr;
+        }
+        if (plugin->command_count > 0 && plugin->commands == nullptr)
+        {
+            SetError(error, "Plugin " + path + " declares commands but has no command table.");
+            return nullptr;
+        }
+        library->plugin = plugin;
+        if (plugin->name != nullptr && plugin->name[0] != '\0')
+        {
+            library->name = plugin->name;
+        }
+        return library;
+    }
+
+    bool PluginHost::LoadDirectory(const std::string& directory, const std::function<bool(const std::string&)>& is_reserved, std::string* error)
+    {
+        std::error_code list_error;
+        std::vector<std::string> paths;
+        for (const auto& item : std::filesystem::directory_iterator(directory, list_error))
+        {
+            if (item.is_regular_file() && item.path().extension() == ".so")
+            {
+                paths.push_back(item.path().string());
+            }
+        }
+        if (list_error)
+        {
+            SetError(error, "Unable to read plugin directory " + directory + ": " + list_error.message());
+            return false;
+        }
+        std::sort(paths.begin(), paths.end());
+
+        auto table = std::make_shared<Table>();
+        for (const std::string& path : paths)
+        {
+            std::shared_ptr<Library> library = OpenLibrary(path, error);
+            if (!library)
+            {
+                return false;
+            }
+
+            const absinthe_plugin& plugin = *library->plugin;
+            for (std::size_t i = 0; i < plugin.command_count; ++i)
+            {
+                const absinthe_command& entry = plugin.commands[i];
+                if (entry.name == nullptr || entry.name[0] == '\0' || entry.run == nullptr)
+                {
+                    SetError(error, "Plugin " + library->name + " has an incomplete command at index " + std::to_string(i) + ".");
+                    return false;
+                }
+                if (is_reserved && is_reserved(entry.name))
+                {
+                    LOG_WARNING("Plugin " << library->name << " command \"" << entry.name << "\" shadows a built-in command, ignored");
+                    continue;
+                }
+
+                Command command;
+                command.name = entry.name;
+                command.usage = entry.usage ? entry.usage : "";
+                command.plugin = library->name;
+                command.run = entry.run;
+                command.user_data = plugin.user_data;
+                const auto [existing, inserted] = table->commands.emplace(command.name, command);
+                if (!inserted)
+                {
+                    SetError(error, "Command \"" + command.name + "\" is defined by both " + existing->second.plugin
+                        + " and " + library->name + ".");
+                    return false;
+                }
+            }
+            table->libraries.push_back(std::move(library));
+        }
+
+        staged_ = std::move(table);
+        return true;
+    }
+
+    bool PluginHost::Commit()
+    {
+        if (!staged_)
+        {
+            return false;
+        }
+        active_ = std::move(staged_);
+        return true;
+    }
+
+    bool PluginHost::HasStaged() const
+    {
+        return staged_ != nullptr;
+    }
+
+    std::shared_ptr<const PluginHost::Command> PluginHost::Find(const std::string& name) const
+    {
+        if (!active_)
+        {
+            return nullptr;
+        }
+        const auto it = active_->commands.find(name);
+        if (it == active_->commands.end())
+        {
+            return nullptr;
+        }
+        return std::shared_ptr<const Command>(active_, &it->second);
+    }
+
+    std::vector<std::string> PluginHost::GetCommandNames() const
+    {
+        std::vector<std::string> names;
+        if (active_)
+        {
+            for (const auto& [name, command] : active_->commands)
+            {
+                names.push_back(name);
+            }
+            std::sort(names.begin(), names.end());
+        }
+        return names;
+    }
+
+    std::string PluginHost::Describe() const
+    {
+        if (!active_ || active_->libraries.empty())
+        {
+            return "No plugins loaded.";
+        }
+
+        std::map<std::string, std::vector<std::string>> by_plugin;
+        for (const auto& [name, command] : active_->commands)
+        {
+            by_plugin[command.plugin].push_back(command.usage.empty() ? name : command.usage);
+        }
+
+        std::ostringstream stream;
+        stream << active_->libraries.size() << " plugins, " << active_->commands.size() << " commands:";
+        for (const auto& library : active_->libraries)
+        {
+            std::vector<std::string>& usages = by_plugin[library->name];
+            std::sort(usages.begin(), usages.end());
+            stream << ' ' << library->name << " (";
+            for (std::size_t i = 0; i < usages.size(); ++i)
+            {
+                stream << (i == 0 ? "" : ", ") << usages[i];
+            }
+            stream << ')';
+        }
+        return stream.str();
+    }
+
+    bool PluginHost::Invoke(const Command& command, const std::vector<std::string>& args, const ReplyFn& reply)
+    {
+        constexpr std::size_t kInlineArgs = 16;
+        const char* inline_args[kInlineArgs];
+        std::vector<const char*> heap_args;
+        const char** argv = inline_args;
+        if (args.size() > kInlineArgs)
+        {
+            heap_args.resize(args.size());
+            argv = heap_args.data();
+        }
+        for (std::size_t i = 0; i < args.size(); ++i)
+        {
+            argv[i] = args[i].c_str();
+        }
+
+        const absinthe_reply sink{ const_cast<ReplyFn*>(&reply), ForwardReply };
+        return command.run(command.user_data, argv, args.size(), &sink) == 0;
+    }
+}
@@ -0,0 +1,248 @@
+#include "absinthe/profiler.hpp"
+
+#if USE_PROFILING
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <time.h>
+#endif
+
+namespace absinthe
+{
+#if USE_PROFILING
+    namespace
+    {
+        struct AllocationCounters
+        {
+            std::uint64_t allocations;
+            std::uint64_t bytes;
+            bool paused;
+        };
+
+        constinit thread_local AllocationCounters allocation_counters{};
+
+        struct StageStats
+        {
+            std::uint64_t calls = 0;
+            ProfileCounters totals;
+        };
+
+        struct ProfileState
+        {
+            std::mutex mutex;
+            std::map<std::string, StageStats> stages;
+        };
+
+        ProfileState& State()
+        {
+            static ProfileState state;
+            return state;
+        }
+
+        void* CountedAllocate(const std::size_t size, const std::size_t alignment)
+        {
+            if (!allocation_counters.paused)
+            {
+                ++allocation_counters.allocations;
+                allocation_counters.bytes += size;
+            }
+            const std::size_t request = size == 0 ? 1 : size;
+            if (alignment > alignof(std::max_align_t))
+            {
+                return std::aligned_alloc(alignment, (request + alignment - 1) / alignment * alignment);
+            }
+            return std::malloc(request);
+        }
+
+        void* CountedAllocateOrThrow(const std::size_t size, const std::size_t alignment)
+        {
+            void* ptr = CountedAllocate(size, alignment);
+            if (!ptr)
+            {
+                throw std::bad_alloc();
+            }
+            return ptr;
+        }
+
+        std::string FormatRow(const std::string& name, const StageStats& stats)
+        {
+            const double calls = static_cast<double>(std::max<std::uint64_t>(stats.calls, 1));
+            char line[256];
+            std::snprintf(line, sizeof(line), "%s: %llu calls, %.1f allocs/call, %.0f B/call, %.1f us/call",
+                name.c_str(), static_cast<unsigned long long>(stats.calls),
+                stats.totals.allocations / calls, stats.totals.bytes / calls, stats.totals.cpu_ns / calls / 1000.0);
+            return line;
+        }
+    }
+
+    ProfileCounters Profiler::Sample()
+    {
+        timespec cpu{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+        ProfileCounters counters;
+        counters.allocations = allocation_counters.allocations;
+        counters.bytes = allocation_counters.bytes;
+        counters.cpu_ns = static_cast<std::uint64_t>(cpu.tv_sec) * 1'000'000'000ull + static_cast<std::uint64_t>(cpu.tv_nsec);
+        return counters;
+    }
+
+    void Profiler::Record(const char* name, const char* detail, const ProfileCounters& start)
+    {
+        const ProfileCounters end = Sample();
+
+        // The bookkeeping below allocates; keep it out of enclosing spans.
+        allocation_counters.paused = true;
+        std::string key = name;
+        if (detail && *detail)
+        {
+            key += ' ';
+            key += detail;
+        }
+        {
+            ProfileState& state = State();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            StageStats& stats = state.stages[key];
+            ++stats.calls;
+            stats.totals.allocations += end.allocations - start.allocations;
+            stats.totals.bytes += end.bytes - start.bytes;
+            stats.totals.cpu_ns += end.cpu_ns - start.cpu_ns;
+        }
+        allocation_counters.paused = false;
+    }
+
+    std::string Profiler::FormatReport(const std::size_t max_rows)
+    {
+        std::vector<std::pair<std::string, StageStats>> rows;
+        {
+            ProfileState& state = State();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            rows.assign(state.stages.begin(), state.stages.end());
+        }
+        if (rows.empty())
+        {
+            return "No profiled stages yet.";
+        }
+
+        std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+            return a.second.totals.bytes > b.second.totals.bytes;
+        });
+        if (max_rows > 0 && rows.size() > max_rows)
+        {
+            rows.resize(max_rows);
+        }
+
+        std::string output;
+        for (const auto& [name, stats] : rows)
+        {
+            if (!output.empty())
+            {
+                output.push_back('\n');
+            }
+            output += FormatRow(name, stats);
+        }
+        return output;
+    }
+
+    void Profiler::Reset()
+    {
+        ProfileState& state = State();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.stages.clear();
+    }
+#else
+    ProfileCounters Profiler::Sample()
+    {
+        return ProfileCounters{};
+    }
+
+    void Profiler::Record(const char*, const char*, const ProfileCounters&)
+    {
+    }
+
+    std::string Profiler::FormatReport(std::size_t)
+    {
+        return "Profiling is not compiled in, rebuild with -DABSINTHE_ENABLE_PROFILING=ON.";
+    }
+
+    void Profiler::Reset()
+    {
+    }
+#endif
+}
+
+#if USE_PROFILING
+void* operator new(const std::size_t size)
+{
+    return absinthe::CountedAllocateOrThrow(size, 0);
+}
+
+void* operator new[](const std::size_t size)
+{
+    return absinthe::CountedAllocateOrThrow(size, 0);
+}
+
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept
+{
+    return absinthe::CountedAllocate(size, 0);
+}
+
+void* operator new[](const std::size_t size, const std::nothrow_t&) noexcept
+{
+    return absinthe::CountedAllocate(size, 0);
+}
+
+void* operator new(const std::size_t size, const std::align_val_t alignment)
+{
+    return absinthe::CountedAllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](const std::size_t size, const std::align_val_t alignment)
+{
+    return absinthe::CountedAllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
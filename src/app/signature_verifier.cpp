@@ -0,0 +1,368 @@
+#include "absinthe/signature_verifier.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "absinthe/metrics.hpp"
+#include "absinthe/thread_layout.hpp"
+#include "absinthe/trace.hpp"
+#include "botcraft/Utilities/Logger.hpp"
+#include "protocolCraft/Packets/Game/Clientbound/ClientboundPlayerChatPacket.hpp"
+#if PROTOCOL_VERSION > 760 /* > 1.19.2 */
+#include "protocolCraft/Packets/Game/Clientbound/ClientboundPlayerInfoRemovePacket.hpp"
+#include "protocolCraft/Packets/Game/Clientbound/ClientboundPlayerInfoUpdatePacket.hpp"
+#endif
+
+#if USE_ENCRYPTION
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#endif
+
+namespace absinthe
+{
+    namespace
+    {
+        void AppendInt32(std::vector<unsigned char>& output, const std::uint32_t value)
+        {
+            for (int shift = 24; shift >= 0; shift -= 8)
+            {
+                output.push_back(static_cast<unsigned char>((value >> shift) & 0xFF));
+            }
+        }
+
+        void AppendInt64(std::vector<unsigned char>& output, const std::uint64_t value)
+        {
+            for (int shift = 56; shift >= 0; shift -= 8)
+            {
+                output.push_back(static_cast<unsigned char>((value >> shift) & 0xFF));
+            }
+        }
+
+        template <typename Bytes>
+        std::optional<ChatSignatureVerifier::Signature> ToSignature(const Bytes& bytes)
+        {
+            if (bytes.size() != ChatSignatureVerifier::kSignatureSize)
+            {
+                return std::nullopt;
+            }
+            ChatSignatureVerifier::Signature signature{};
+            std::copy(bytes.begin(), bytes.end(), signature.begin());
+            return signature;
+        }
+
+        std::size_t SenderShard(const ProtocolCraft::UUID& sender, const std::size_t shard_count)
+        {
+            std::size_t hash = 0;
+            for (const unsigned char byte : sender)
+            {
+                hash = hash * 131 + byte;
+            }
+            return hash % shard_count;
+        }
+
+        long long NowMilliseconds()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    struct ChatSignatureVerifier::PlayerKey
+    {
+        ProtocolCraft::UUID session_id{};
+        long long expires_at_ms = 0;
+#if USE_ENCRYPTION
+        std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> public_key{ nullptr, EVP_PKEY_free };
+#endif
+    };
+
+    ChatSignatureVerifier::ChatSignatureVerifier(std::string prefix, const std::size_t worker_count)
+        : prefix_(std::move(prefix))
+    {
+        const std::size_t count = std::max<std::size_t>(1, worker_count);
+        workers_.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        for (auto& worker : workers_)
+        {
+            worker->thread = std::thread(&ChatSignatureVerifier::WorkerLoop, this, std::ref(*worker));
+        }
+    }
+
+    ChatSignatureVerifier::~ChatSignatureVerifier()
+    {
+        Stop();
+    }
+
+    bool ChatSignatureVerifier::IsSupported()
+    {
+#if USE_ENCRYPTION && PROTOCOL_VERSION > 760 /* > 1.19.2 */
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void ChatSignatureVerifier::Stop()
+    {
+        stopping_.store(true);
+        for (auto& worker : workers_)
+        {
+            {
+                std::lock_guard<std::mutex> lock(worker->mutex);
+            }
+            worker->wake.notify_all();
+            if (worker->thread.joinable())
+            {
+                worker->thread.join();
+            }
+        }
+    }
+
+    void ChatSignatureVerifier::ResetConnection()
+    {
+        for (auto& worker : workers_)
+        {
+            std::unique_lock<std::mutex> lock(worker->mutex);
+            if (!worker->thread.joinable())
+            {
+                worker->jobs.clear();
+                continue;
+            }
+            worker->idle.wait(lock, [&]() { return worker->jobs.empty() && !worker->busy; });
+        }
+
+        signature_cache_.fill(std::nullopt);
+        std::lock_guard<std::mutex> lock(keys_mutex_);
+        keys_.clear();
+    }
+
+    bool ChatSignatureVerifier::AddSession(const ProtocolCraft::UUID& player, const ProtocolCraft::UUID& session_id,
+        const long long expires_at_ms, const std::vector<unsigned char>& der)
+    {
+#if USE_ENCRYPTION
+        auto key = std::make_shared<PlayerKey>();
+        key->session_id = session_id;
+        key->expires_at_ms = expires_at_ms;
+        const unsigned char* cursor = der.data();
+        key->public_key.reset(d2i_PUBKEY(nullptr, &cursor, static_cast<long>(der.size())));
+        if (!key->public_key)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(keys_mutex_);
+        keys_[player] = std::move(key);
+        return true;
+#else
+        (void)player;
+        (void)session_id;
+        (void)expires_at_ms;
+        (void)der;
+        return false;
+#endif
+    }
+
+#if PROTOCOL_VERSION > 760 /* > 1.19.2 */
+    void ChatSignatureVerifier::UpdateSessions(const ProtocolCraft::ClientboundPlayerInfoUpdatePacket& packet)
+    {
+        for (const auto& [uuid, entry] : packet.GetEntries())
+        {
+            const auto& session = entry.GetChatSession();
+            if (!session.has_value())
+            {
+                continue;
+            }
+
+            if (!AddSession(uuid, session->GetUuid(), session->GetProfilePublicKey().GetTimestamp(), session->GetProfilePublicKey().GetKey()))
+            {
+                LOG_WARNING("Ignoring unreadable chat session key for " << entry.GetGameProfile().GetName());
+            }
+        }
+    }
+
+    void ChatSignatureVerifier::RemoveSessions(const ProtocolCraft::ClientboundPlayerInfoRemovePacket& packet)
+    {
+        std::lock_guard<std::mutex> lock(keys_mutex_);
+        for (const auto& uuid : packet.GetProfileIds())
+        {
+            keys_.erase(uuid);
+        }
+    }
+
+    bool ChatSignatureVerifier::Submit(const ProtocolCraft::ClientboundPlayerChatPacket& packet, ChatMessage& message, ChatInbox& destination)
+    {
+        const auto& body = packet.GetBody();
+
+        // Last-seen entries reference our cache by id + 1; id 0 carries the full signature.
+        std::vector<Signature> last_seen;
+        bool last_seen_resolved = true;
+        for (const auto& packed : body.GetLastSeen())
+        {
+            if (packed.GetFullSignature().has_value())
+            {
+                const std::optional<Signature> full = ToSignature(packed.GetFullSignature().value());
+                if (full.has_value())
+                {
+                    last_seen.push_back(full.value());
+                    continue;
+                }
+                last_seen_resolved = false;
+                continue;
+            }
+
+            const int index = packed.GetId() - 1;
+            if (index < 0 || index >= static_cast<int>(signature_cache_.size()) || !signature_cache_[index].has_value())
+            {
+                last_seen_resolved = false;
+                continue;
+            }
+            last_seen.push_back(signature_cache_[index].value());
+        }
+
+        std::optional<Signature> signature;
+        if (packet.GetSignature().has_value())
+        {
+            signature = ToSignature(packet.GetSignature().value());
+        }
+
+        std::vector<Signature> seen = last_seen;
+        if (signature.has_value())
+        {
+            seen.push_back(signature.value());
+        }
+        PushSignatures(std::move(seen));
+
+        // Only the body is signed. A server may decorate it with unsigned
+        // content, which must never be what a verified command runs.
+        const std::string& content = body.GetContent();
+        if (content.empty() || content.rfind(prefix_, 0) != 0)
+        {
+            return false;
+        }
+        if (!signature.has_value() || !last_seen_resolved)
+        {
+            return false;
+        }
+
+        std::shared_ptr<const PlayerKey> key;
+        {
+            std::lock_guard<std::mutex> lock(keys_mutex_);
+            const auto it = keys_.find(message.sender);
+            if (it != keys_.end())
+            {
+                key = it->second;
+            }
+        }
+        if (!key || key->expires_at_ms < NowMilliseconds())
+        {
+            return false;
+        }
+
+        Job job;
+        job.key = std::move(key);
+        job.signature = signature.value();
+        job.destination = &destination;
+
+        job.payload.reserve(64 + content.size() + last_seen.size() * kSignatureSize);
+        AppendInt32(job.payload, 1);
+        job.payload.insert(job.payload.end(), message.sender.begin(), message.sender.end());
+        job.payload.insert(job.payload.end(), job.key->session_id.begin(), job.key->session_id.end());
+        AppendInt32(job.payload, static_cast<std::uint32_t>(packet.GetIndex()));
+        AppendInt64(job.payload, static_cast<std::uint64_t>(body.GetSalt()));
+        AppendInt64(job.payload, static_cast<std::uint64_t>(body.GetTimestamp() / 1000));
+        AppendInt32(job.payload, static_cast<std::uint32_t>(content.size()));
+        job.payload.insert(job.payload.end(), content.begin(), content.end());
+        AppendInt32(job.payload, static_cast<std::uint32_t>(last_seen.size()));
+        for (const Signature& seen_signature : last_seen)
+        {
+            job.payload.insert(job.payload.end(), seen_signature.begin(), seen_signature.end());
+        }
+        job.message = std::move(message);
+        job.message.content = content;
+        job.message.has_signature = true;
+
+        Worker& worker = *workers_[SenderShard(job.message.sender, workers_.size())];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.jobs.push_back(std::move(job));
+        }
+        worker.wake.notify_one();
+        return true;
+    }
+#endif
+
+    void ChatSignatureVerifier::PushSignatures(std::vector<Signature> signatures)
+    {
+        // Same update as the vanilla MessageSignatureCache: newest entries go to
+        // the front and displaced entries that were not just seen shift back.
+        const std::vector<Signature> present = signatures;
+        std::deque<Signature> pending(signatures.begin(), signatures.end());
+        for (std::size_t i = 0; !pending.empty() && i < signature_cache_.size(); ++i)
+        {
+            std::optional<Signature> displaced = std::move(signature_cache_[i]);
+            signature_cache_[i] = pending.back();
+            pending.pop_back();
+            if (displaced.has_value() && std::find(present.begin(), present.end(), displaced.value()) == present.end())
+            {
+                pending.push_front(displaced.value());
+            }
+        }
+    }
+
+    void ChatSignatureVerifier::WorkerLoop(Worker& worker)
+    {
+        Botcraft::Logger::GetInstance().RegisterThread("signature verifier");
+        Tracer::SetThreadName("signature verifier");
+        ThreadLayout::GetInstance().ApplyToCurrentThread(ThreadRole::Network, "verify");
+#if USE_ENCRYPTION
+        std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> context(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+#endif
+
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(worker.mutex);
+                worker.wake.wait(lock, [&]() { return stopping_.load() || !worker.jobs.empty(); });
+                if (worker.jobs.empty())
+                {
+                    return;
+                }
+                job = std::move(worker.jobs.front());
+                worker.jobs.pop_front();
+                worker.busy = true;
+            }
+
+            bool verified = false;
+            {
+                ABSINTHE_TRACE_SPAN("verify signature");
+#if USE_ENCRYPTION
+                EVP_MD_CTX_reset(context.get());
+                if (EVP_DigestVerifyInit(context.get(), nullptr, EVP_sha256(), nullptr, job.key->public_key.get()) == 1)
+                {
+                    verified = EVP_DigestVerify(context.get(), job.signature.data(), job.signature.size(),
+                        job.payload.data(), job.payload.size()) == 1;
+                }
+#endif
+            }
+
+            Metrics& metrics = Metrics::GetInstance();
+            metrics.Add("absinthe_signature_verifications_total", 1);
+            if (!verified)
+            {
+                metrics.Add("absinthe_signature_failures_total", 1);
+            }
+
+            job.message.signature_verified = verified;
+            job.destination->PushMessage(std::move(job.message));
+            {
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                worker.busy = false;
+            }
+            worker.idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,330 @@
+#include "absinthe/thread_layout.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "botcraft/Utilities/Logger.hpp"
+
+namespace absinthe
+{
+    namespace
+    {
+        constexpr const char* kRoleNames[] = { "network", "behaviour", "persistence", "logging" };
+
+        bool ParseNumber(const std::string& value, int& result)
+        {
+            try
+            {
+                size_t used = 0;
+                result = std::stoi(value, &used);
+                return used == value.size();
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+        }
+
+        bool ParseCpuList(const std::string& value, std::vector<int>& cpus)
+        {
+            size_t start = 0;
+            while (start <= value.size())
+            {
+                const size_t end = std::min(value.find(',', start), value.size());
+                const std::string item = value.substr(start, end - start);
+                const size_t dash = item.find('-');
+                int first = 0;
+                int last = 0;
+                if (dash == std::string::npos)
+                {
+                    if (!ParseNumber(item, first))
+                    {
+                        return false;
+                    }
+                    last = first;
+                }
+                else if (!ParseNumber(item.substr(0, dash), first) || !ParseNumber(item.substr(dash + 1), last))
+                {
+                    return false;
+                }
+                if (first < 0 || last < first || last >= CPU_SETSIZE)
+                {
+                    return false;
+                }
+                for (int cpu = first; cpu <= last; ++cpu)
+                {
+                    cpus.push_back(cpu);
+                }
+                start = end + 1;
+            }
+            std::sort(cpus.begin(), cpus.end());
+            cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+            return !cpus.empty();
+        }
+
+        std::string FormatCpuList(const cpu_set_t& set)
+        {
+            std::string output;
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if (!CPU_ISSET(cpu, &set))
+                {
+                    continue;
+                }
+                int last = cpu;
+                while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set))
+                {
+                    ++last;
+                }
+                if (!output.empty())
+                {
+                    output.push_back(',');
+                }
+                output += std::to_string(cpu);
+                if (last > cpu)
+                {
+                    output += "-" + std::to_string(last);
+                }
+                cpu = last;
+            }
+            return output;
+        }
+
+        std::string ReadThreadName(const pid_t tid)
+        {
+            std::ifstream file("/proc/self/task/" + std::to_string(tid) + "/comm");
+            std::string name;
+            std::getline(file, name);
+            return name;
+        }
+
+        bool SplitSpec(const std::string& spec, ThreadRole& role, std::string& value, std::string* error)
+        {
+            const size_t equals = spec.find('=');
+            const std::optional<ThreadRole> parsed = equals == std::string::npos
+                ? std::nullopt
+                : ThreadLayout::ParseRole(spec.substr(0, equals));
+            if (!parsed.has_value())
+            {
+                if (error)
+                {
+                    *error = "Expected <role>=<value> with role network, behaviour, persistence or logging, got \"" + spec + "\"";
+                }
+                return false;
+            }
+            role = parsed.value();
+            value = spec.substr(equals + 1);
+            return true;
+        }
+    }
+
+    ThreadLayout& ThreadLayout::GetInstance()
+    {
+        static ThreadLayout instance;
+        return instance;
+    }
+
+    std::optional<ThreadRole> ThreadLayout::ParseRole(const std::string& name)
+    {
+        for (size_t i = 0; i < std::size(kRoleNames); ++i)
+        {
+            if (name == kRoleNames[i])
+            {
+                return static_cast<ThreadRole>(i);
+            }
+        }
+        return std::nullopt;
+    }
+
+    const char* ThreadLayout::GetRoleName(const ThreadRole role)
+    {
+        return kRoleNames[static_cast<size_t>(role)];
+    }
+
+    std::vector<pid_t> ThreadLayout::ListThreads()
+    {
+        std::vector<pid_t> tids;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator("/proc/self/task", error))
+        {
+            int tid = 0;
+            if (ParseNumber(entry.path().filename().string(), tid))
+            {
+                tids.push_back(static_cast<pid_t>(tid));
+            }
+        }
+        std::sort(tids.begin(), tids.end());
+        return tids;
+    }
+
+    bool ThreadLayout::SetCpus(const std::string& spec, std::string* error)
+    {
+        ThreadRole role;
+        std::string value;
+        if (!SplitSpec(spec, role, value, error))
+        {
+            return false;
+        }
+        std::vector<int> cpus;
+        if (!ParseCpuList(value, cpus))
+        {
+            if (error)
+            {
+                *error = "Invalid CPU list \"" + value + "\", expected e.g. 0-3,6";
+            }
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        roles[static_cast<size_t>(role)].cpus = std::move(cpus);
+        return true;
+    }
+
+    bool ThreadLayout::SetNice(const std::string& spec, std::string* error)
+    {
+        ThreadRole role;
+        std::string value;
+        if (!SplitSpec(spec, role, value, error))
+        {
+            return false;
+        }
+        int nice = 0;
+        if (!ParseNumber(value, nice) || nice < -20 || nice > 19)
+        {
+            if (error)
+            {
+                *error = "Invalid nice value \"" + value + "\", expected -20..19";
+            }
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        roles[static_cast<size_t>(role)].nice = nice;
+        return true;
+    }
+
+    void ThreadLayout::ApplyToCurrentThread(const ThreadRole role, const char* name)
+    {
+        Apply(role, static_cast<pid_t>(gettid()), name, true);
+    }
+
+    void ThreadLayout::RegisterCurrentThread(const ThreadRole role)
+    {
+        const pid_t tid = static_cast<pid_t>(gettid());
+        Apply(role, tid, ReadThreadName(tid), true);
+    }
+
+    void ThreadLayout::RunInRole(const ThreadRole role, const char* name, const std::function<void()>& fn)
+    {
+        std::exception_ptr failure;
+        std::thread runner([&]() {
+            Apply(role, static_cast<pid_t>(gettid()), name, false);
+            try
+            {
+                fn();
+            }
+            catch (...)
+            {
+                failure = std::current_exception();
+            }
+        });
+        runner.join();
+        if (failure)
+        {
+            std::rethrow_exception(failure);
+        }
+    }
+
+    void ThreadLayout::Apply(const ThreadRole role, const pid_t tid, const std::string& name, const bool record)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const RoleConfig& config = roles[static_cast<size_t>(role)];
+
+        // Linux limits thread names to 15 bytes plus the terminator.
+        const std::string short_name = name.substr(0, 15);
+        pthread_setname_np(pthread_self(), short_name.c_str());
+
+        std::string error;
+        if (!config.cpus.empty())
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (const int cpu : config.cpus)
+            {
+                CPU_SET(cpu, &set);
+            }
+            if (sched_setaffinity(0, sizeof(set), &set) != 0)
+            {
+                error = std::string("affinity: ") + std::strerror(errno);
+            }
+        }
+        if (config.nice.has_value() && setpriority(PRIO_PROCESS, static_cast<id_t>(tid), config.nice.value()) != 0)
+        {
+            error += (error.empty() ? "" : ", ") + std::string("nice: ") + std::strerror(errno);
+        }
+
+        if (!record)
+        {
+            if (!error.empty())
+            {
+                LOG_WARNING("Unable to place " << short_name << " threads: " << error);
+            }
+            return;
+        }
+
+        // Threads of earlier connections are gone; drop them so the report
+        // does not grow with every reconnect.
+        const std::vector<pid_t> live = ListThreads();
+        placements.erase(std::remove_if(placements.begin(), placements.end(), [&live](const Placement& placement) {
+            return !std::binary_search(live.begin(), live.end(), placement.tid);
+        }), placements.end());
+
+        const auto it = std::find_if(placements.begin(), placements.end(), [tid](const Placement& placement) {
+            return placement.tid == tid;
+        });
+        Placement& placement = it != placements.end() ? *it : placements.emplace_back();
+        placement.role = role;
+        placement.tid = tid;
+        placement.name = short_name;
+        placement.error = error;
+    }
+
+    std::string ThreadLayout::FormatReport() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string output = "Thread layout (role, tid, name, cpus, nice):";
+        for (const Placement& placement : placements)
+        {
+            output += "\n  " + std::string(GetRoleName(placement.role)) + " " + std::to_string(placement.tid) + " ";
+            const std::string name = ReadThreadName(placement.tid);
+            if (name.empty())
+            {
+                output += placement.name + " exited";
+                continue;
+            }
+
+            // Report what the kernel actually has, not what was requested.
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            const std::string cpus = sched_getaffinity(placement.tid, sizeof(set), &set) == 0 ? FormatCpuList(set) : "?";
+            errno = 0;
+            const int nice = getpriority(PRIO_PROCESS, static_cast<id_t>(placement.tid));
+            output += name + " cpus " + cpus + " nice " + (errno == 0 ? std::to_string(nice) : "?");
+            if (!placement.error.empty())
+            {
+                output += " (" + placement.error + ")";
+            }
+        }
+        return output;
+    }
+}
@@ -0,0 +1,304 @@
+#include "absinthe/trace.hpp"
+#include "absinthe/thread_layout.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "botcraft/Utilities/Logger.hpp"
+
+namespace absinthe
+{
+    namespace
+    {
+        constexpr std::size_t kRingCapacity = 4096;
+        constexpr std::size_t kDetailSize = 32;
+
+        struct TraceEvent
+        {
+            const char* name = nullptr;
+            std::uint64_t start_ns = 0;
+            std::uint64_t end_ns = 0;
+            char detail[kDetailSize] = {};
+        };
+
+        struct ThreadRing
+        {
+            std::array<TraceEvent, kRingCapacity> events;
+            std::atomic<std::uint64_t> head{ 0 };
+            std::atomic<std::uint64_t> tail{ 0 };
+            std::atomic<std::uint64_t> dropped{ 0 };
+            std::atomic<bool> exited{ false };
+            long tid = 0;
+            std::string thread_name;
+            bool name_written = false;
+        };
+
+        struct TraceState
+        {
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::vector<std::shared_ptr<ThreadRing>> rings;
+            std::ofstream file;
+            std::thread flusher;
+            std::uint64_t released_dropped = 0;
+            bool stopping = false;
+            bool first_event = true;
+        };
+
+        TraceState& State()
+        {
+            static TraceState state;
+            return state;
+        }
+
+        // Marks the ring on thread exit so the flusher frees it once drained.
+        struct LocalRingOwner
+        {
+            std::shared_ptr<ThreadRing> ring;
+
+            ~LocalRingOwner()
+            {
+                if (ring)
+                {
+                    ring->exited.store(true, std::memory_order_release);
+                }
+            }
+        };
+
+        thread_local LocalRingOwner local_ring;
+
+        ThreadRing& LocalRing()
+        {
+            if (!local_ring.ring)
+            {
+                auto ring = std::make_shared<ThreadRing>();
+                ring->tid = static_cast<long>(syscall(SYS_gettid));
+                TraceState& state = State();
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.rings.push_back(ring);
+                local_ring.ring = std::move(ring);
+            }
+            return *local_ring.ring;
+        }
+
+        void AppendEscaped(std::string& output, const char* value)
+        {
+            for (const char* c = value; *c != '\0'; ++c)
+            {
+                const unsigned char uc = static_cast<unsigned char>(*c);
+                if (uc == '"' || uc == '\\')
+                {
+                    output.push_back('\\');
+                    output.push_back(*c);
+                }
+                else if (uc < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", uc);
+                    output += escaped;
+                }
+                else
+                {
+                    output.push_back(*c);
+                }
+            }
+        }
+
+        void AppendSeparator(TraceState& state, std::string& output)
+        {
+            output += state.first_event ? "\n" : ",\n";
+            state.first_event = false;
+        }
+
+        // Called with the state mutex held. Rings of exited threads are
+        // released once their last events are written.
+        void Drain(TraceState& state)
+        {
+            std::string output;
+            for (auto it = state.rings.begin(); it != state.rings.end();)
+            {
+                const std::shared_ptr<ThreadRing>& ring = *it;
+                const bool exited = ring->exited.load(std::memory_order_acquire);
+                if (!ring->name_written && !ring->thread_name.empty())
+                {
+                    AppendSeparator(state, output);
+                    output += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(ring->tid)
+                        + ",\"args\":{\"name\":\"";
+                    AppendEscaped(output, ring->thread_name.c_str());
+                    output += "\"}}";
+                    ring->name_written = true;
+                }
+
+                const std::uint64_t head = ring->head.load(std::memory_order_acquire);
+                std::uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+                for (; tail != head; ++tail)
+                {
+                    const TraceEvent& event = ring->events[tail % kRingCapacity];
+                    char timing[96];
+                    std::snprintf(timing, sizeof(timing), "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%ld",
+                        event.start_ns / 1000.0, (event.end_ns - event.start_ns) / 1000.0, ring->tid);
+
+                    AppendSeparator(state, output);
+                    output += "{\"name\":\"";
+                    AppendEscaped(output, event.name);
+                    output += timing;
+                    if (event.detail[0] != '\0')
+                    {
+                        output += ",\"args\":{\"detail\":\"";
+                        AppendEscaped(output, event.detail);
+                        output += "\"}";
+                    }
+                    output += "}";
+                }
+                ring->tail.store(tail, std::memory_order_release);
+
+                if (exited)
+                {
+                    state.released_dropped += ring->dropped.load(std::memory_order_relaxed);
+                    it = state.rings.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+
+            if (!output.empty())
+            {
+                state.file << output;
+                state.file.flush();
+            }
+        }
+
+        void FlushLoop()
+        {
+            ThreadLayout::GetInstance().ApplyToCurrentThread(ThreadRole::Logging, "trace");
+            TraceState& state = State();
+            std::unique_lock<std::mutex> lock(state.mutex);
+            while (!state.stopping)
+            {
+                state.wake.wait_for(lock, std::chrono::milliseconds(100));
+                Drain(state);
+            }
+        }
+    }
+
+    bool Tracer::Start(const std::string& path, std::string* error)
+    {
+        TraceState& state = State();
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.file.is_open())
+            {
+                if (error)
+                {
+                    *error = "Tracing is already running.";
+                }
+                return false;
+            }
+
+            state.file.open(path, std::ios::trunc);
+            if (!state.file.is_open())
+            {
+                if (error)
+                {
+                    *error = "Unable to open trace file: " + path;
+                }
+                return false;
+            }
+
+            state.file << "[";
+            state.released_dropped = 0;
+            state.stopping = false;
+            state.first_event = true;
+        }
+
+        state.flusher = std::thread(FlushLoop);
+        enabled.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    void Tracer::Stop()
+    {
+        TraceState& state = State();
+        enabled.store(false, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (!state.file.is_open())
+            {
+                return;
+            }
+            state.stopping = true;
+        }
+        state.wake.notify_all();
+        if (state.flusher.joinable())
+        {
+            state.flusher.join();
+        }
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        Drain(state);
+        std::uint64_t dropped = state.released_dropped;
+        for (const auto& ring : state.rings)
+        {
+            dropped += ring->dropped.load(std::memory_order_relaxed);
+        }
+        if (dropped > 0)
+        {
+            LOG_WARNING("Tracing dropped " << dropped << " spans because a thread buffer was full");
+        }
+        state.file << "\n]\n";
+        state.file.close();
+    }
+
+    std::uint64_t Tracer::Now()
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void Tracer::Record(const char* name, const std::uint64_t start_ns, const std::uint64_t end_ns, const char* detail)
+    {
+        ThreadRing& ring = LocalRing();
+        const std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+        if (head - ring.tail.load(std::memory_order_acquire) >= kRingCapacity)
+        {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        TraceEvent& event = ring.events[head % kRingCapacity];
+        event.name = name;
+        event.start_ns = start_ns;
+        event.end_ns = end_ns;
+        event.detail[0] = '\0';
+        if (detail)
+        {
+            std::snprintf(event.detail, kDetailSize, "%s", detail);
+        }
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    void Tracer::SetThreadName(const char* name)
+    {
+        if (!IsEnabled())
+        {
+            return;
+        }
+
+        ThreadRing& ring = LocalRing();
+        std::lock_guard<std::mutex> lock(State().mutex);
+        ring.thread_name = name;
+        ring.name_written = false;
+    }
+}
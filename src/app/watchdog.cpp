@@ -0,0 +1,223 @@
+#include "absinthe/watchdog.hpp"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <sstream>
+
+#include <execinfo.h>
+
+#include "absinthe/metrics.hpp"
+#include "absinthe/thread_layout.hpp"
+#include "absinthe/trace.hpp"
+#include "botcraft/Utilities/Logger.hpp"
+
+namespace absinthe
+{
+    namespace
+    {
+        constexpr int kSampleSignal = SIGUSR2;
+        constexpr int kMaxFrames = 64;
+        constexpr std::uint64_t kPublishIntervalNs = 1'000'000'000ull;
+
+        void* sampled_frames[kMaxFrames];
+        std::atomic<int> sampled_frame_count{ -1 };
+
+        void SampleStack(int)
+        {
+            sampled_frame_count.store(backtrace(sampled_frames, kMaxFrames), std::memory_order_release);
+        }
+
+        void InstallSampler()
+        {
+            // backtrace() loads libgcc lazily; do it here rather than in the handler.
+            void* warmup[1];
+            backtrace(warmup, 1);
+
+            struct sigaction action{};
+            action.sa_handler = SampleStack;
+            sigemptyset(&action.sa_mask);
+            action.sa_flags = SA_RESTART;
+            sigaction(kSampleSignal, &action, nullptr);
+        }
+    }
+
+    Watchdog::~Watchdog()
+    {
+        Stop();
+    }
+
+    void Watchdog::Start(const std::chrono::milliseconds budget)
+    {
+        if (thread_.joinable() || budget.count() <= 0)
+        {
+            return;
+        }
+
+        budget_ = budget;
+        stopping_ = false;
+        InstallSampler();
+        thread_ = std::thread(&Watchdog::Run, this);
+    }
+
+    void Watchdog::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(stop_mutex_);
+            stopping_ = true;
+        }
+        stop_cv_.notify_all();
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+        PublishMetrics();
+    }
+
+    void Watchdog::BeginTick()
+    {
+        const std::uint64_t now = Tracer::Now();
+        // Every connection ticks on its own behaviour thread, so the thread
+        // to sample changes after a reconnect or a standby takeover.
+        tick_thread_.store(pthread_self(), std::memory_order_relaxed);
+        has_tick_thread_.store(true, std::memory_order_release);
+        tick_start_ns_.store(now, std::memory_order_release);
+        last_heartbeat_ns_.store(now, std::memory_order_relaxed);
+    }
+
+    void Watchdog::EndTick()
+    {
+        const std::uint64_t now = Tracer::Now();
+        const std::uint64_t start = tick_start_ns_.exchange(0, std::memory_order_acq_rel);
+        last_heartbeat_ns_.store(now, std::memory_order_relaxed);
+        tick_count_.fetch_add(1, std::memory_order_relaxed);
+        if (start == 0)
+        {
+            return;
+        }
+
+        const std::uint64_t elapsed = now - start;
+        std::uint64_t longest = longest_tick_ns_.load(std::memory_order_relaxed);
+        while (elapsed > longest && !longest_tick_ns_.compare_exchange_weak(longest, elapsed, std::memory_order_relaxed))
+        {
+        }
+
+        // Ticks run under the dispatch lock, one at a time.
+        if (now - published_ns_ >= kPublishIntervalNs)
+        {
+            published_ns_ = now;
+            PublishMetrics();
+        }
+    }
+
+    void Watchdog::Pause()
+    {
+        last_heartbeat_ns_.store(0, std::memory_order_relaxed);
+    }
+
+    void Watchdog::SetActivity(const std::string& activity)
+    {
+        std::lock_guard<std::mutex> lock(activity_mutex_);
+        activity_ = activity;
+    }
+
+    std::uint64_t Watchdog::GetStallCount() const
+    {
+        return stall_count_.load(std::memory_order_relaxed);
+    }
+
+    std::chrono::microseconds Watchdog::GetLongestTick() const
+    {
+        return std::chrono::microseconds(longest_tick_ns_.load(std::memory_order_relaxed) / 1000);
+    }
+
+    void Watchdog::Run()
+    {
+        ThreadLayout::GetInstance().ApplyToCurrentThread(ThreadRole::Logging, "watchdog");
+        const std::uint64_t budget_ns = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(budget_).count());
+        const auto poll_interval = std::max(budget_ / 4, std::chrono::milliseconds(5));
+        std::uint64_t reported_tick_start = 0;
+        std::uint64_t reported_heartbeat = 0;
+
+        std::unique_lock<std::mutex> lock(stop_mutex_);
+        while (!stop_cv_.wait_for(lock, poll_interval, [this]() { return stopping_; }))
+        {
+            const std::uint64_t now = Tracer::Now();
+            const std::uint64_t tick_start = tick_start_ns_.load(std::memory_order_acquire);
+            const std::uint64_t heartbeat = last_heartbeat_ns_.load(std::memory_order_relaxed);
+
+            if (tick_start != 0 && now - tick_start > budget_ns && tick_start != reported_tick_start)
+            {
+                reported_tick_start = tick_start;
+                ReportStall(now - tick_start, true);
+            }
+            else if (tick_start == 0 && heartbeat != 0 && now - heartbeat > 4 * budget_ns && heartbeat != reported_heartbeat)
+            {
+                reported_heartbeat = heartbeat;
+                ReportStall(now - heartbeat, false);
+            }
+        }
+    }
+
+    void Watchdog::PublishMetrics()
+    {
+        Metrics& metrics = Metrics::GetInstance();
+        metrics.Set("absinthe_ticks_total", static_cast<double>(tick_count_.load(std::memory_order_relaxed)));
+        metrics.Set("absinthe_tick_longest_seconds", longest_tick_ns_.load(std::memory_order_relaxed) / 1e9);
+        metrics.Set("absinthe_tick_stalls_total", static_cast<double>(stall_count_.load(std::memory_order_relaxed)));
+    }
+
+    void Watchdog::ReportStall(const std::uint64_t elapsed_ns, const bool in_tick)
+    {
+        stall_count_.fetch_add(1, std::memory_order_relaxed);
+
+        std::string activity;
+        {
+            std::lock_guard<std::mutex> lock(activity_mutex_);
+            activity = activity_;
+        }
+
+        if (!in_tick)
+        {
+            LOG_WARNING("Watchdog: no chat tick for " << elapsed_ns / 1000000 << " ms (last activity: " << activity << ")");
+            return;
+        }
+
+        LOG_WARNING("Watchdog: chat tick running for " << elapsed_ns / 1000000 << " ms, budget "
+            << budget_.count() << " ms (activity: " << activity << ")");
+
+        if (!has_tick_thread_.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        sampled_frame_count.store(-1, std::memory_order_relaxed);
+        if (pthread_kill(tick_thread_.load(std::memory_order_relaxed), kSampleSignal) != 0)
+        {
+            return;
+        }
+
+        int frame_count = -1;
+        for (int i = 0; i < 100 && frame_count < 0; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            frame_count = sampled_frame_count.load(std::memory_order_acquire);
+        }
+        if (frame_count <= 0)
+        {
+            LOG_WARNING("Watchdog: stack sample unavailable");
+            return;
+        }
+
+        char** symbols = backtrace_symbols(sampled_frames, frame_count);
+        std::ostringstream stack;
+        // Skip the signal handler and trampoline frames.
+        for (int i = 2; i < frame_count; ++i)
+        {
+            stack << "\n    #" << i - 2 << ' ' << (symbols ? symbols[i] : "?");
+        }
+        std::free(symbols);
+        LOG_WARNING("Watchdog: stalled thread stack:" << stack.str());
+    }
+}
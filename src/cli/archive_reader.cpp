@@ -0,0 +1,124 @@
+#include "absinthe/chat_archive.hpp"
+
+#include <ctime>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    void ShowUsage(const char* argv0)
+    {
+        std::cout << "Usage: " << argv0 << " <archive> [options]\n"
+            << "Options:\n"
+            << "\t-h, --help\tShow this help message\n"
+            << "\t--from <unix seconds>\tOnly print chat received at or after this time\n"
+            << "\t--to <unix seconds>\tOnly print chat received at or before this time\n"
+            << "\t--sender <name|uuid>\tOnly print chat from this player\n"
+            << "\t--stats\tPrint how many blocks were scanned and decoded\n"
+            << std::endl;
+    }
+
+    bool ParseSeconds(const char* value, std::int64_t& milliseconds)
+    {
+        try
+        {
+            size_t used = 0;
+            const long long seconds = std::stoll(value, &used);
+            if (used != std::string(value).size())
+            {
+                return false;
+            }
+            milliseconds = seconds * 1000;
+            return true;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+
+    std::string FormatTime(const std::int64_t milliseconds)
+    {
+        const std::time_t seconds = static_cast<std::time_t>(milliseconds / 1000);
+        std::tm utc {};
+        gmtime_r(&seconds, &utc);
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &utc);
+        return buffer;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string path;
+    absinthe::ChatArchiveReader::Query query;
+    bool print_stats = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help")
+        {
+            ShowUsage(argv[0]);
+            return 0;
+        }
+        if ((arg == "--from" || arg == "--to") && i + 1 < argc)
+        {
+            if (!ParseSeconds(argv[++i], arg == "--from" ? query.from_ms : query.to_ms))
+            {
+                std::cerr << arg << " requires a unix timestamp in seconds" << std::endl;
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "--sender" && i + 1 < argc)
+        {
+            query.sender = argv[++i];
+            continue;
+        }
+        if (arg == "--stats")
+        {
+            print_stats = true;
+            continue;
+        }
+        if (path.empty() && arg[0] != '-')
+        {
+            path = arg;
+            continue;
+        }
+
+        std::cerr << "Unknown argument: " << arg << std::endl;
+        return 1;
+    }
+
+    if (path.empty())
+    {
+        ShowUsage(argv[0]);
+        return 1;
+    }
+
+    absinthe::ChatArchiveReader reader;
+    std::string error;
+    if (!reader.Open(path, &error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    absinthe::ChatArchiveReader::Stats stats;
+    const bool ok = reader.Scan(query, [](const absinthe::archive::Record& record) {
+        std::cout << FormatTime(record.time_ms) << " <" << record.sender_name << "> " << record.content << '\n';
+    }, &stats, &error);
+    std::cout.flush();
+
+    if (print_stats)
+    {
+        std::cerr << stats.matches << " of " << stats.records << " decoded messages matched, "
+            << stats.blocks_decoded << " of " << stats.blocks << " blocks decoded" << std::endl;
+    }
+    if (!ok)
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    return 0;
+}
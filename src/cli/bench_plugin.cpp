@@ -0,0 +1,25 @@
+#include "absinthe/plugin_api.h"
+
+// Minimal plugin for absinthe_plugin_bench: one command that replies "pong",
+// the same work as the built-in ping.
+namespace
+{
+    int Ping(void*, const char* const*, size_t, const absinthe_reply* reply)
+    {
+        reply->reply(reply->context, "pong", 4);
+        return 0;
+    }
+
+    const absinthe_command kCommands[] = {
+        { "bench_ping", "bench_ping", Ping }
+    };
+
+    const absinthe_plugin kPlugin = {
+        ABSINTHE_PLUGIN_ABI_VERSION, "bench", kCommands, sizeof(kCommands) / sizeof(kCommands[0]), nullptr, nullptr
+    };
+}
+
+extern "C" const absinthe_plugin* absinthe_plugin_init(void)
+{
+    return &kPlugin;
+}
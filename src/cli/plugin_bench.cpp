@@ -0,0 +1,134 @@
+#include "absinthe/chat_handler.hpp"
+#include "absinthe/chat_whitelist.hpp"
+#include "absinthe/plugin_host.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef ABSINTHE_BENCH_PLUGIN_DIR
+#define ABSINTHE_BENCH_PLUGIN_DIR "plugins"
+#endif
+
+namespace
+{
+    void ShowUsage(const char* argv0)
+    {
+        std::cout << "Usage: " << argv0 << " [options]\n"
+            << "Options:\n"
+            << "\t-h, --help\tShow this help message\n"
+            << "\t--plugins <dir>\tDirectory holding the bench plugin, default: " ABSINTHE_BENCH_PLUGIN_DIR "\n"
+            << "\t--iterations <n>\tCommands dispatched per run, default: 2000000\n"
+            << std::endl;
+    }
+
+    bool ParseCount(const char* value, int& count)
+    {
+        try
+        {
+            size_t used = 0;
+            count = std::stoi(value, &used);
+            return used == std::string(value).size() && count > 0;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+
+    // Runs fn iterations times and returns nanoseconds per call.
+    template <typename Fn>
+    double Measure(const int iterations, Fn&& fn)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            fn();
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string plugins_path = ABSINTHE_BENCH_PLUGIN_DIR;
+    int iterations = 2000000;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help")
+        {
+            ShowUsage(argv[0]);
+            return 0;
+        }
+        if (arg == "--plugins" && i + 1 < argc)
+        {
+            plugins_path = argv[++i];
+            continue;
+        }
+        if (arg == "--iterations" && i + 1 < argc)
+        {
+            if (!ParseCount(argv[++i], iterations))
+            {
+                std::cerr << arg << " requires a positive number" << std::endl;
+                return 1;
+            }
+            continue;
+        }
+
+        std::cerr << "Unknown argument: " << arg << std::endl;
+        return 1;
+    }
+
+    absinthe::PluginHost plugins;
+    std::string error;
+    if (!plugins.LoadDirectory(plugins_path, absinthe::ChatWhitelist::IsBuiltinCommand, &error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    plugins.Commit();
+    if (!plugins.Find("bench_ping"))
+    {
+        std::cerr << "No plugin in " << plugins_path << " provides bench_ping" << std::endl;
+        return 1;
+    }
+
+    // Both paths copy their reply into a string, as SendFeedback does.
+    const absinthe::ChatHandler handler;
+    std::uint64_t reply_bytes = 0;
+    const auto builtin = [&](const absinthe::ChatCommand& command) {
+        for (const std::string& reply : handler.HandleCommand(command))
+        {
+            reply_bytes += reply.size();
+        }
+    };
+    const absinthe::PluginHost::ReplyFn reply = [&](std::string_view text) {
+        reply_bytes += std::string(text).size();
+    };
+    const auto plugin = [&](const absinthe::ChatCommand& command) {
+        if (const auto found = plugins.Find(command.name))
+        {
+            absinthe::PluginHost::Invoke(*found, command.args, reply);
+        }
+    };
+
+    const absinthe::ChatCommand ping = handler.Parse("?ping").command;
+    const absinthe::ChatCommand bench_ping = handler.Parse("?bench_ping").command;
+    // Warm up caches and the allocator before timing.
+    Measure(iterations / 10, [&]() { builtin(ping); plugin(bench_ping); });
+
+    const double builtin_dispatch = Measure(iterations, [&]() { builtin(ping); });
+    const double plugin_dispatch = Measure(iterations, [&]() { plugin(bench_ping); });
+    const double builtin_total = Measure(iterations, [&]() { builtin(handler.Parse("?ping").command); });
+    const double plugin_total = Measure(iterations, [&]() { plugin(handler.Parse("?bench_ping").command); });
+
+    std::cout << "Dispatch only:      built-in " << builtin_dispatch << " ns, plugin " << plugin_dispatch << " ns ("
+        << plugin_dispatch / builtin_dispatch << "x)\n"
+        << "Parse and dispatch: built-in " << builtin_total << " ns, plugin " << plugin_total << " ns ("
+        << plugin_total / builtin_total << "x)\n"
+        << "(" << reply_bytes << " reply bytes)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include "absinthe/chat_triggers.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    void ShowUsage(const char* argv0)
+    {
+        std::cout << "Usage: " << argv0 << " [options]\n"
+            << "Options:\n"
+            << "\t-h, --help\tShow this help message\n"
+            << "\t--patterns <n>\tNumber of trigger patterns, default: 5000\n"
+            << "\t--megabytes <n>\tAmount of chat to scan, default: 256\n"
+            << "\t--line-length <n>\tAverage chat line length in bytes, default: 80\n"
+            << std::endl;
+    }
+
+    bool ParseCount(const char* value, int& count)
+    {
+        try
+        {
+            size_t used = 0;
+            count = std::stoi(value, &used);
+            return used == std::string(value).size() && count > 0;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+
+    std::string RandomWord(std::mt19937& random, const int min_length, const int max_length)
+    {
+        std::uniform_int_distribution<int> length(min_length, max_length);
+        std::uniform_int_distribution<int> letter(0, 25);
+        std::string word(static_cast<size_t>(length(random)), 'a');
+        for (char& c : word)
+        {
+            c = static_cast<char>('a' + letter(random));
+        }
+        return word;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int pattern_count = 5000;
+    int megabytes = 256;
+    int line_length = 80;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help")
+        {
+            ShowUsage(argv[0]);
+            return 0;
+        }
+        if ((arg == "--patterns" || arg == "--megabytes" || arg == "--line-length") && i + 1 < argc)
+        {
+            int& target = arg == "--patterns" ? pattern_count : arg == "--megabytes" ? megabytes : line_length;
+            if (!ParseCount(argv[++i], target))
+            {
+                std::cerr << arg << " requires a positive number" << std::endl;
+                return 1;
+            }
+            continue;
+        }
+
+        std::cerr << "Unknown argument: " << arg << std::endl;
+        return 1;
+    }
+
+    std::mt19937 random(42);
+    std::vector<absinthe::ChatTrigger> triggers(static_cast<size_t>(pattern_count));
+    for (absinthe::ChatTrigger& trigger : triggers)
+    {
+        trigger.pattern = RandomWord(random, 4, 12);
+    }
+
+    const auto build_start = std::chrono::steady_clock::now();
+    const absinthe::TriggerAutomaton automaton(triggers);
+    const double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+    std::cout << pattern_count << " patterns: " << automaton.GetStateCount() << " states, "
+        << automaton.GetMemoryUsage() / 1024 << " KiB, built in " << build_seconds * 1000.0 << " ms" << std::endl;
+
+    // 1 MiB of mixed-case chat lines; about one in twenty words is a pattern.
+    std::vector<std::string> lines;
+    std::size_t corpus_bytes = 0;
+    std::uniform_int_distribution<int> pick(0, pattern_count - 1);
+    std::uniform_int_distribution<int> percent(0, 99);
+    while (corpus_bytes < (1u << 20))
+    {
+        std::string line;
+        while (line.size() < static_cast<size_t>(line_length))
+        {
+            std::string word = percent(random) < 5 ? triggers[static_cast<size_t>(pick(random))].pattern : RandomWord(random, 2, 9);
+            if (percent(random) < 10)
+            {
+                word[0] = static_cast<char>(word[0] - 'a' + 'A');
+            }
+            line += line.empty() ? word : " " + word;
+        }
+        corpus_bytes += line.size();
+        lines.push_back(std::move(line));
+    }
+
+    std::vector<std::uint32_t> matches;
+    std::uint64_t scanned = 0;
+    std::uint64_t scanned_lines = 0;
+    std::uint64_t hits = 0;
+    const std::uint64_t target = static_cast<std::uint64_t>(megabytes) << 20;
+    const auto start = std::chrono::steady_clock::now();
+    while (scanned < target)
+    {
+        for (const std::string& line : lines)
+        {
+            matches.clear();
+            automaton.Scan(line, matches);
+            hits += matches.size();
+            scanned += line.size();
+        }
+        scanned_lines += lines.size();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Scanned " << scanned / (1 << 20) << " MiB of chat: " << scanned / seconds / 1e6 << " MB/s, "
+        << static_cast<std::uint64_t>(scanned_lines / seconds) << " lines/s, " << hits << " matches" << std::endl;
+    return 0;
+}
@@ -0,0 +1,304 @@
+#include "absinthe/chat_client.hpp"
+#include "absinthe/signature_verifier.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if USE_ENCRYPTION && PROTOCOL_VERSION > 760 /* > 1.19.2 */
+#include "protocolCraft/Packets/Game/Clientbound/ClientboundPlayerChatPacket.hpp"
+
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#endif
+
+namespace
+{
+    void ShowUsage(const char* argv0)
+    {
+        std::cout << "Usage: " << argv0 << " [options]\n"
+            << "Options:\n"
+            << "\t-h, --help\tShow this help message\n"
+            << "\t--messages <n>\tSigned command messages per run, default: 20000\n"
+            << "\t--players <n>\tDistinct senders, each with its own key, default: 16\n"
+            << "\t--workers <n>\tVerifier worker threads, default: 1, 2, 4, ... up to the core count\n"
+            << std::endl;
+    }
+
+    bool ParseCount(const char* value, int& count)
+    {
+        try
+        {
+            size_t used = 0;
+            count = std::stoi(value, &used);
+            return used == std::string(value).size() && count > 0;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+
+#if USE_ENCRYPTION && PROTOCOL_VERSION > 760 /* > 1.19.2 */
+    using KeyPtr = std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)>;
+
+    // Stand-in for the server side: each player signs its chat with its own
+    // profile key the way a vanilla client does, and the server relays the
+    // result as a player chat packet.
+    struct Player
+    {
+        ProtocolCraft::UUID uuid{};
+        ProtocolCraft::UUID session_id{};
+        KeyPtr key{ nullptr, EVP_PKEY_free };
+        std::vector<unsigned char> der;
+        int index = 0;
+    };
+
+    KeyPtr GenerateKey()
+    {
+        KeyPtr key(nullptr, EVP_PKEY_free);
+        std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)> context(EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr), EVP_PKEY_CTX_free);
+        EVP_PKEY* generated = nullptr;
+        if (context && EVP_PKEY_keygen_init(context.get()) == 1
+            && EVP_PKEY_CTX_set_rsa_keygen_bits(context.get(), 2048) == 1
+            && EVP_PKEY_keygen(context.get(), &generated) == 1)
+        {
+            key.reset(generated);
+        }
+        return key;
+    }
+
+    void AppendInt(std::vector<unsigned char>& output, const std::uint64_t value, const int bytes)
+    {
+        for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8)
+        {
+            output.push_back(static_cast<unsigned char>((value >> shift) & 0xFF));
+        }
+    }
+
+    // The vanilla client's signed message layout, with no last-seen entries.
+    std::vector<unsigned char> SignedPayload(const Player& player, const std::string& content, const long long salt, const long long timestamp_ms)
+    {
+        std::vector<unsigned char> payload;
+        AppendInt(payload, 1, 4);
+        payload.insert(payload.end(), player.uuid.begin(), player.uuid.end());
+        payload.insert(payload.end(), player.session_id.begin(), player.session_id.end());
+        AppendInt(payload, static_cast<std::uint32_t>(player.index), 4);
+        AppendInt(payload, static_cast<std::uint64_t>(salt), 8);
+        AppendInt(payload, static_cast<std::uint64_t>(timestamp_ms / 1000), 8);
+        AppendInt(payload, static_cast<std::uint32_t>(content.size()), 4);
+        payload.insert(payload.end(), content.begin(), content.end());
+        AppendInt(payload, 0, 4);
+        return payload;
+    }
+
+    // ProtocolCraft stores signatures as a fixed array or a vector depending
+    // on the version.
+    template <typename Bytes>
+    Bytes ToSignatureBytes(const std::vector<unsigned char>& signature)
+    {
+        Bytes bytes{};
+        if constexpr (requires(Bytes& value) { value.resize(0); })
+        {
+            bytes.resize(signature.size());
+        }
+        std::copy(signature.begin(), signature.end(), bytes.begin());
+        return bytes;
+    }
+
+    bool MakePacket(Player& player, const std::string& content, std::mt19937_64& random, ProtocolCraft::ClientboundPlayerChatPacket& packet)
+    {
+        const long long salt = static_cast<long long>(random());
+        const long long timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        const std::vector<unsigned char> payload = SignedPayload(player, content, salt, timestamp_ms);
+
+        std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> context(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+        std::vector<unsigned char> signature(absinthe::ChatSignatureVerifier::kSignatureSize);
+        size_t signature_size = signature.size();
+        if (!context || EVP_DigestSignInit(context.get(), nullptr, EVP_sha256(), nullptr, player.key.get()) != 1
+            || EVP_DigestSign(context.get(), signature.data(), &signature_size, payload.data(), payload.size()) != 1
+            || signature_size != signature.size())
+        {
+            return false;
+        }
+
+        std::remove_cvref_t<decltype(packet.GetBody())> body;
+        body.SetContent(content);
+        body.SetTimestamp(timestamp_ms);
+        body.SetSalt(salt);
+
+        packet.SetSender(player.uuid);
+        packet.SetIndex(player.index++);
+        packet.SetSignature(ToSignatureBytes<typename std::remove_cvref_t<decltype(packet.GetSignature())>::value_type>(signature));
+        packet.SetBody(body);
+        return true;
+    }
+
+    struct RunResult
+    {
+        double seconds = 0.0;
+        std::size_t verified = 0;
+        std::size_t failed = 0;
+    };
+
+    RunResult Run(const int workers, const std::vector<Player>& players, std::vector<ProtocolCraft::ClientboundPlayerChatPacket>& packets)
+    {
+        absinthe::ChatSignatureVerifier verifier("?", static_cast<std::size_t>(workers));
+        const long long expires_at_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            (std::chrono::system_clock::now() + std::chrono::hours(24)).time_since_epoch()).count();
+        for (const Player& player : players)
+        {
+            verifier.AddSession(player.uuid, player.session_id, expires_at_ms, player.der);
+        }
+
+        absinthe::ChatInbox inbox;
+        RunResult result;
+        const auto start = std::chrono::steady_clock::now();
+        for (auto& packet : packets)
+        {
+            absinthe::ChatMessage message;
+            absinthe::ReadPlayerChat(packet, message);
+            if (!verifier.Submit(packet, message, inbox))
+            {
+                ++result.failed;
+            }
+        }
+
+        std::size_t received = result.failed;
+        absinthe::ChatMessage message;
+        while (received < packets.size())
+        {
+            if (!inbox.PopMessage(message))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            ++received;
+            if (message.signature_verified)
+            {
+                ++result.verified;
+            }
+            else
+            {
+                ++result.failed;
+            }
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        verifier.Stop();
+        return result;
+    }
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+    int message_count = 20000;
+    int player_count = 16;
+    int fixed_workers = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help")
+        {
+            ShowUsage(argv[0]);
+            return 0;
+        }
+        if ((arg == "--messages" || arg == "--players" || arg == "--workers") && i + 1 < argc)
+        {
+            int& target = arg == "--messages" ? message_count : arg == "--players" ? player_count : fixed_workers;
+            if (!ParseCount(argv[++i], target))
+            {
+                std::cerr << arg << " requires a positive number" << std::endl;
+                return 1;
+            }
+            continue;
+        }
+
+        std::cerr << "Unknown argument: " << arg << std::endl;
+        return 1;
+    }
+
+#if USE_ENCRYPTION && PROTOCOL_VERSION > 760 /* > 1.19.2 */
+    std::mt19937_64 random(std::random_device{}());
+    std::vector<Player> players(static_cast<size_t>(player_count));
+    for (Player& player : players)
+    {
+        for (unsigned char& byte : player.uuid)
+        {
+            byte = static_cast<unsigned char>(random());
+        }
+        for (unsigned char& byte : player.session_id)
+        {
+            byte = static_cast<unsigned char>(random());
+        }
+        player.key = GenerateKey();
+        unsigned char* der = nullptr;
+        const int der_size = player.key ? i2d_PUBKEY(player.key.get(), &der) : -1;
+        if (der_size <= 0)
+        {
+            std::cerr << "Unable to generate a player key" << std::endl;
+            return 1;
+        }
+        player.der.assign(der, der + der_size);
+        OPENSSL_free(der);
+    }
+
+    std::cout << "Signing " << message_count << " commands from " << player_count << " players..." << std::endl;
+    std::vector<ProtocolCraft::ClientboundPlayerChatPacket> packets(static_cast<size_t>(message_count));
+    for (size_t i = 0; i < packets.size(); ++i)
+    {
+        if (!MakePacket(players[i % players.size()], "?ping " + std::to_string(i), random, packets[i]))
+        {
+            std::cerr << "Unable to sign test traffic" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<int> worker_counts;
+    if (fixed_workers > 0)
+    {
+        worker_counts.push_back(fixed_workers);
+    }
+    else
+    {
+        const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int workers = 1; workers < cores; workers *= 2)
+        {
+            worker_counts.push_back(workers);
+        }
+        worker_counts.push_back(cores);
+    }
+
+    for (const int workers : worker_counts)
+    {
+        const RunResult result = Run(workers, players, packets);
+        const double rate = result.verified / result.seconds;
+        std::cout << workers << " workers: " << static_cast<long long>(rate) << " verifications/s, "
+            << static_cast<long long>(rate / workers) << " per core";
+        if (result.failed > 0)
+        {
+            std::cout << ", " << result.failed << " FAILED";
+        }
+        std::cout << std::endl;
+        if (result.failed > 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+#else
+    (void)message_count;
+    (void)player_count;
+    (void)fixed_workers;
+    std::cerr << "Signature verification requires Botcraft built with encryption and protocol > 1.19.2" << std::endl;
+    return 1;
+#endif
+}
@@ -0,0 +1,144 @@
+#include "absinthe/audit_log.hpp"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    int failures = 0;
+
+    using Record = std::array<unsigned char, absinthe::audit::kRecordSize>;
+
+    void Expect(const bool condition, const std::string& what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    }
+
+    absinthe::audit::Entry MakeEntry()
+    {
+        absinthe::audit::Entry entry;
+        entry.time_ms = 1760000000123;
+        for (std::size_t i = 0; i < entry.sender.size(); ++i)
+        {
+            entry.sender[i] = static_cast<unsigned char>(0xA0 + i);
+        }
+        entry.player = "Steve";
+        entry.source = absinthe::audit::Source::Control;
+        entry.result = absinthe::audit::Result::Cancelled;
+        entry.signature = absinthe::audit::Signature::Verified;
+        entry.command = "remind 60 feed the cats";
+        return entry;
+    }
+
+    Record Seal(const absinthe::audit::Entry& entry)
+    {
+        Record record{};
+        absinthe::audit::Encode(entry, record.data());
+        absinthe::audit::Seal(record.data());
+        return record;
+    }
+
+    bool Decodes(const Record& record)
+    {
+        absinthe::audit::Entry entry;
+        return absinthe::audit::Decode(record.data(), entry);
+    }
+
+    void TestRoundTrip()
+    {
+        const absinthe::audit::Entry original = MakeEntry();
+        absinthe::audit::Entry decoded;
+        Expect(absinthe::audit::Decode(Seal(original).data(), decoded), "a sealed record decodes");
+        Expect(decoded.time_ms == original.time_ms && decoded.sender == original.sender, "time and sender survive");
+        Expect(decoded.source == original.source && decoded.result == original.result && decoded.signature == original.signature,
+            "source, result and signature survive");
+        Expect(decoded.player == original.player && decoded.command == original.command, "player and command survive");
+    }
+
+    void TestTruncation()
+    {
+        absinthe::audit::Entry entry = MakeEntry();
+        entry.player = std::string(40, 'p');
+        entry.command = std::string(1000, 'c');
+        absinthe::audit::Entry decoded;
+        Expect(absinthe::audit::Decode(Seal(entry).data(), decoded), "an oversized entry still encodes");
+        Expect(decoded.player == std::string(absinthe::audit::kMaxPlayerLength, 'p'), "player is truncated");
+        Expect(decoded.command == std::string(absinthe::audit::kMaxCommandLength, 'c'), "command is truncated");
+    }
+
+    void TestChecksum()
+    {
+        const Record sealed = Seal(MakeEntry());
+        bool rejected = true;
+        for (std::size_t i = 0; i < sealed.size(); ++i)
+        {
+            Record flipped = sealed;
+            flipped[i] ^= 0x10;
+            rejected = rejected && !Decodes(flipped);
+        }
+        Expect(rejected, "a flipped bit anywhere in the record is rejected");
+
+        Record unsealed{};
+        absinthe::audit::Encode(MakeEntry(), unsealed.data());
+        Expect(!Decodes(unsealed), "an unsealed record is rejected");
+    }
+
+    void TestTornTail()
+    {
+        // A crash can leave a zero-filled or half-written last record.
+        Expect(!Decodes(Record{}), "a zeroed record is rejected");
+        Record torn = Seal(MakeEntry());
+        std::fill(torn.begin() + torn.size() / 2, torn.end(), 0);
+        Expect(!Decodes(torn), "a half-written record is rejected");
+
+        const std::size_t header = sizeof(absinthe::audit::kFileMagic);
+        const std::size_t record = absinthe::audit::kRecordSize;
+        Expect(absinthe::audit::CountRecords(0) == 0 && absinthe::audit::CountRecords(header) == 0, "an empty log has no records");
+        Expect(absinthe::audit::CountRecords(header + record) == 1, "a whole record is counted");
+        Expect(absinthe::audit::CountRecords(header + 2 * record - 1) == 1, "a torn tail is not counted");
+        Expect(absinthe::audit::CountRecords(header + 3 * record) == 3, "records are counted from the header");
+    }
+
+    void TestLengthLimits()
+    {
+        // Lengths past the field sizes are rejected even with a valid checksum.
+        Record long_player = Seal(MakeEntry());
+        long_player[27] = static_cast<unsigned char>(absinthe::audit::kMaxPlayerLength + 1);
+        absinthe::audit::Seal(long_player.data());
+        Expect(!Decodes(long_player), "an oversized player length is rejected");
+
+        Record long_command = Seal(MakeEntry());
+        const std::size_t length = absinthe::audit::kMaxCommandLength + 1;
+        long_command[28] = static_cast<unsigned char>(length & 0xFF);
+        long_command[29] = static_cast<unsigned char>(length >> 8);
+        absinthe::audit::Seal(long_command.data());
+        Expect(!Decodes(long_command), "an oversized command length is rejected");
+    }
+
+    void TestNames()
+    {
+        Expect(std::string(absinthe::audit::GetName(absinthe::audit::Result::Cancelled)) == "cancelled", "result names");
+        Expect(std::string(absinthe::audit::GetName(static_cast<absinthe::audit::Source>(9))) == "unknown", "unknown values");
+    }
+}
+
+int main()
+{
+    TestRoundTrip();
+    TestTruncation();
+    TestChecksum();
+    TestTornTail();
+    TestLengthLimits();
+    TestNames();
+    if (failures == 0)
+    {
+        std::cout << "All audit record tests passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
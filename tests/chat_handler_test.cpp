@@ -0,0 +1,101 @@
+#include "absinthe/chat_handler.hpp"
+
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace
+{
+    int failures = 0;
+
+    void Expect(const bool condition, const std::string& what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    }
+
+    // Vanilla servers kick a client that sends a chat message over the limit.
+    void TestHelpFitsInChat(const std::string& prefix)
+    {
+        const absinthe::ChatHandler handler(prefix);
+        absinthe::ChatCommand help;
+        help.name = "help";
+        const std::vector<std::string> lines = handler.HandleCommand(help);
+        Expect(!lines.empty(), "help with prefix \"" + prefix + "\" replies");
+        std::string all;
+        for (const std::string& line : lines)
+        {
+            Expect(!line.empty(), "help line with prefix \"" + prefix + "\" is not empty");
+            Expect(line.size() <= absinthe::ChatHandler::kMaxChatLength, "help line with prefix \"" + prefix + "\" is "
+                + std::to_string(line.size()) + " bytes, over " + std::to_string(absinthe::ChatHandler::kMaxChatLength));
+            all += line + " ";
+        }
+        for (const char* command : { "help", "ping", "echo", "allow", "deny", "list", "remind", "search", "last", "triggers", "prof", "plugins", "audit" })
+        {
+            Expect(all.find(prefix + command) != std::string::npos, std::string("help lists ") + command);
+        }
+    }
+
+    std::string Chain(const std::string& command, const std::size_t count)
+    {
+        std::string message = "?";
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            message += (i > 0 ? "; " : " ") + command;
+        }
+        return message;
+    }
+
+    void TestBatchLimits()
+    {
+        absinthe::ChatHandler handler("?");
+        handler.SetCommandResolver([](const std::string& name) -> std::optional<std::size_t> {
+            return name == "allow" ? std::optional<std::size_t>(3) : std::nullopt;
+        });
+
+        const absinthe::ChatParseResult chained = handler.Parse("?allow Steve; ?deny Alex;list;;");
+        Expect(chained.ok && chained.batch.size() == 3, "\";\" chains commands and skips empty segments");
+        Expect(chained.batch.size() == 3 && chained.batch[1].name == "deny" && chained.batch[1].args == std::vector<std::string>({ "Alex" }),
+            "a repeated prefix inside a batch is dropped");
+        Expect(chained.command.name == "allow" && chained.command.id == std::size_t{ 3 }, "batched commands are resolved");
+
+        const absinthe::ChatParseResult single = handler.Parse("? allow Steve");
+        Expect(single.ok && single.batch.empty() && single.command.args == std::vector<std::string>({ "Steve" }),
+            "a single batchable command is not a batch");
+
+        const absinthe::ChatParseResult full = handler.Parse(Chain("list", 16));
+        Expect(full.ok && full.batch.size() == 16, "a batch of 16 commands is accepted");
+        const absinthe::ChatParseResult over = handler.Parse(Chain("list", 17));
+        Expect(!over.ok && over.is_command && over.error == "Batch too long: at most 16 commands per message.",
+            "a batch of 17 commands is rejected");
+
+        const absinthe::ChatParseResult mixed = handler.Parse("?allow Steve; remind 5 hi");
+        Expect(!mixed.ok && mixed.error.find("\"remind\" cannot be batched") == 0, "a non-batchable command cannot be chained");
+
+        const absinthe::ChatParseResult echo = handler.Parse("?echo a; b");
+        Expect(echo.ok && echo.batch.empty() && echo.command.args == std::vector<std::string>({ "a;", "b" }),
+            "\";\" is plain text after a non-batchable command");
+        Expect(!echo.command.id.has_value(), "an unresolved command has no id");
+
+        Expect(!handler.Parse("?;;").ok, "a batch of empty segments is malformed");
+        Expect(!handler.Parse("hello ?allow").is_command, "a message without the prefix is not a command");
+    }
+}
+
+int main()
+{
+    TestHelpFitsInChat("?");
+    TestHelpFitsInChat("!absinthe ");
+    TestHelpFitsInChat(std::string(40, '#'));
+    TestBatchLimits();
+    if (failures == 0)
+    {
+        std::cout << "All chat handler tests passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+#include "absinthe/chat_history.hpp"
+
+#include <deque>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    int failures = 0;
+
+    void Expect(const bool condition, const std::string& what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    }
+
+    absinthe::ChatMessage MakeMessage(const std::string& sender, const std::string& content)
+    {
+        absinthe::ChatMessage message;
+        message.sender_name = sender;
+        message.content = content;
+        return message;
+    }
+
+    std::vector<std::string> Contents(const std::vector<absinthe::ChatHistory::Entry>& entries)
+    {
+        std::vector<std::string> contents;
+        for (const absinthe::ChatHistory::Entry& entry : entries)
+        {
+            contents.push_back(entry.content);
+        }
+        return contents;
+    }
+
+    void TestRingEviction()
+    {
+        absinthe::ChatHistory history(3, 4096);
+        history.Record(MakeMessage("Alice", "first diamond"));
+        history.Record(MakeMessage("Bob", "second gold"));
+        history.Record(MakeMessage("", ""));
+        history.Record(MakeMessage("Bob", "third diamond"));
+        history.Record(MakeMessage("Carol", "fourth diamond"));
+        history.Record(MakeMessage("Bob", "fifth iron"));
+
+        Expect(history.GetSize() == 3, "the ring keeps the newest three messages");
+        Expect(Contents(history.Search({ "diamond" }, "", 10)) == std::vector<std::string>({ "fourth diamond", "third diamond" }),
+            "search skips evicted messages and returns newest first");
+        Expect(history.Search({ "gold" }, "", 10).empty(), "an evicted message's only token is gone");
+        Expect(!history.HasSender("alice") && !history.Last("Alice"), "a sender with no live messages is dropped");
+        Expect(history.HasSender("BOB") && history.Last("bob")->content == "fifth iron", "sender lookup ignores case");
+        Expect(Contents(history.Search({ "Diamond" }, "carol", 10)) == std::vector<std::string>({ "fourth diamond" }),
+            "player restricts search to that sender");
+        Expect(history.Search({ "diamond", "iron" }, "", 10).empty(), "every term must appear in the message");
+    }
+
+    void TestPostingCompaction()
+    {
+        // Enough evictions to compact the shared posting list several times.
+        absinthe::ChatHistory history(10, 4096);
+        for (int i = 0; i < 500; ++i)
+        {
+            history.Record(MakeMessage(i % 2 ? "Alice" : "Bob", "spam " + std::to_string(i)));
+        }
+
+        const std::vector<std::string> contents = Contents(history.Search({ "spam" }, "", 100));
+        Expect(contents.size() == 10 && contents.front() == "spam 499" && contents.back() == "spam 490",
+            "a compacted posting list still holds exactly the live messages");
+        Expect(Contents(history.Search({ "spam" }, "alice", 2)) == std::vector<std::string>({ "spam 499", "spam 497" }),
+            "limit stops the walk early");
+        Expect(history.Search({ "489" }, "", 10).empty(), "tokens of evicted messages are removed");
+        Expect(Contents(history.Search({ "490" }, "", 10)) == std::vector<std::string>({ "spam 490" }), "the oldest live message is searchable");
+    }
+
+    void TestArenaWrap()
+    {
+        // The arena is the limit here: each message is 100 bytes of a 256
+        // byte arena, so at most two fit and placement wraps every time.
+        absinthe::ChatHistory history(100, 0);
+        for (int i = 0; i < 9; ++i)
+        {
+            history.Record(MakeMessage("Alice", "word" + std::to_string(i) + " " + std::string(94, 'x')));
+        }
+        Expect(history.GetSize() == 2, "the arena evicts messages that would be overwritten");
+        Expect(Contents(history.Search({ "word8" }, "", 10)).size() == 1, "the newest message survives the wrap");
+        Expect(history.Search({ "word8" }, "", 10).front().content.size() == 100, "wrapped content is stored intact");
+        Expect(Contents(history.Search({ "word7" }, "", 10)).size() == 1, "the previous message survives the wrap");
+        Expect(history.Search({ "word6" }, "", 10).empty(), "older messages are evicted by the arena");
+
+        history.Record(MakeMessage("Bob", std::string(1000, 'y')));
+        Expect(history.GetSize() == 1 && history.Last("Bob")->content.size() == 256, "content longer than the arena is truncated");
+        Expect(!history.HasSender("Alice"), "arena eviction drops senders too");
+    }
+
+    void TestAgainstModel()
+    {
+        constexpr std::size_t kCapacity = 16;
+        const std::vector<std::string> words = { "alpha", "beta", "gamma", "delta" };
+        const std::vector<std::string> names = { "Alice", "Bob", "Carol" };
+        std::mt19937 random(11);
+        std::uniform_int_distribution<std::size_t> word(0, words.size() - 1);
+        std::uniform_int_distribution<std::size_t> name(0, names.size() - 1);
+
+        absinthe::ChatHistory history(kCapacity, 1 << 16);
+        std::deque<std::pair<std::string, std::string>> model;
+        for (int i = 0; i < 2000; ++i)
+        {
+            const std::string sender = names[name(random)];
+            const std::string content = words[word(random)] + " " + words[word(random)] + " " + std::to_string(i);
+            history.Record(MakeMessage(sender, content));
+            model.emplace_back(sender, content);
+            if (model.size() > kCapacity)
+            {
+                model.pop_front();
+            }
+
+            const std::string term = words[word(random)];
+            const std::string player = i % 3 == 0 ? names[name(random)] : "";
+            std::vector<std::string> expected;
+            for (auto it = model.rbegin(); it != model.rend(); ++it)
+            {
+                const bool has_term = (it->second + " ").find(term + " ") != std::string::npos;
+                if (has_term && (player.empty() || it->first == player))
+                {
+                    expected.push_back(it->second);
+                }
+            }
+            if (Contents(history.Search({ term }, player, kCapacity)) != expected)
+            {
+                Expect(false, "search agrees with a naive scan after message " + std::to_string(i));
+                return;
+            }
+        }
+    }
+}
+
+int main()
+{
+    TestRingEviction();
+    TestPostingCompaction();
+    TestArenaWrap();
+    TestAgainstModel();
+    if (failures == 0)
+    {
+        std::cout << "All chat history tests passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
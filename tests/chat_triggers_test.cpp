@@ -0,0 +1,160 @@
+#include "absinthe/chat_triggers.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    int failures = 0;
+
+    void Expect(const bool condition, const std::string& what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    }
+
+    std::vector<absinthe::ChatTrigger> MakeTriggers(const std::vector<std::string>& patterns)
+    {
+        std::vector<absinthe::ChatTrigger> triggers;
+        for (const std::string& pattern : patterns)
+        {
+            triggers.emplace_back();
+            triggers.back().pattern = pattern;
+        }
+        return triggers;
+    }
+
+    std::vector<std::uint32_t> Scan(const std::vector<std::string>& patterns, const std::string& text)
+    {
+        const absinthe::TriggerAutomaton automaton(MakeTriggers(patterns));
+        std::vector<std::uint32_t> matches;
+        automaton.Scan(text, matches);
+        return matches;
+    }
+
+    std::string Lower(std::string value)
+    {
+        std::transform(value.begin(), value.end(), value.begin(), [](const unsigned char c) {
+            return static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+        });
+        return value;
+    }
+
+    void TestOverlappingPatterns()
+    {
+        // "he", "she", "his" and "hers" overlap in "ushers".
+        const std::vector<std::uint32_t> matches = Scan({ "he", "she", "his", "hers" }, "ushers");
+        Expect(matches == std::vector<std::uint32_t>({ 0, 1, 3 }), "overlapping patterns all match in \"ushers\"");
+    }
+
+    void TestSharedSuffixes()
+    {
+        // Each pattern is a suffix of the next, so every hit goes through
+        // dictionary links rather than the state's own output.
+        const std::vector<std::uint32_t> matches = Scan({ "c", "bc", "abc", "xabc" }, "zzabc");
+        Expect(matches == std::vector<std::uint32_t>({ 0, 1, 2 }), "shared-suffix patterns match through dictionary links");
+    }
+
+    void TestCaseFoldingAndDuplicates()
+    {
+        const std::vector<std::uint32_t> matches = Scan({ "Diamond", "diamond", "gold" }, "DIAMOND diamond DiAmOnD");
+        Expect(matches == std::vector<std::uint32_t>({ 0, 1 }), "matching ignores case and reports each trigger once");
+        Expect(Scan({ "gold" }, "go ld").empty(), "a broken pattern does not match");
+        Expect(Scan({}, "anything").empty(), "an empty automaton matches nothing");
+    }
+
+    void TestAgainstNaiveSearch()
+    {
+        std::mt19937 random(7);
+        std::uniform_int_distribution<int> letter(0, 3);
+        std::uniform_int_distribution<int> length(1, 4);
+        for (int round = 0; round < 200; ++round)
+        {
+            std::vector<std::string> patterns(6);
+            for (std::string& pattern : patterns)
+            {
+                for (int i = length(random); i > 0; --i)
+                {
+                    pattern.push_back(static_cast<char>((letter(random) % 2 ? 'a' : 'A') + letter(random)));
+                }
+            }
+            std::string text;
+            for (int i = 0; i < 40; ++i)
+            {
+                text.push_back(static_cast<char>('a' + letter(random)));
+            }
+
+            std::vector<std::uint32_t> expected;
+            for (std::uint32_t i = 0; i < patterns.size(); ++i)
+            {
+                if (Lower(text).find(Lower(patterns[i])) != std::string::npos)
+                {
+                    expected.push_back(i);
+                }
+            }
+            if (Scan(patterns, text) != expected)
+            {
+                Expect(false, "automaton agrees with a naive search for \"" + text + "\"");
+                return;
+            }
+        }
+    }
+
+    void TestLoadCommitAndCooldown()
+    {
+        const std::string path = "absinthe_chat_triggers_test.yaml";
+        {
+            std::ofstream file(path, std::ios::trunc);
+            file << "triggers:\n"
+                << "  - diamond\n"
+                << "  - pattern: hello\n"
+                << "    action: reply\n"
+                << "    reply: hi\n"
+                << "    cooldown: 60\n";
+        }
+
+        absinthe::ChatTriggers triggers;
+        std::string error;
+        Expect(triggers.LoadFromFile(path, &error), "triggers file loads: " + error);
+        Expect(triggers.IsEmpty() && triggers.HasStaged(), "a load is only staged");
+        Expect(triggers.Commit() && !triggers.HasStaged(), "commit swaps the staged set in");
+        Expect(triggers.GetCount() == 2, "both triggers are active");
+        Expect(!triggers.Commit(), "a second commit has nothing to swap in");
+
+        const std::vector<absinthe::ChatTriggers::Hit> first = triggers.Match("Hello there");
+        Expect(first.size() == 1 && first.front().trigger->reply == "hi" && !first.front().cooling_down, "reply trigger fires");
+        const std::vector<absinthe::ChatTriggers::Hit> second = triggers.Match("hello again");
+        Expect(second.size() == 1 && second.front().cooling_down, "reply trigger cools down");
+
+        {
+            std::ofstream file(path, std::ios::trunc);
+            file << "triggers:\n  - pattern: x\n    action: explode\n";
+        }
+        Expect(!triggers.LoadFromFile(path, &error) && !triggers.HasStaged(), "a bad file stages nothing");
+        Expect(triggers.GetCount() == 2, "a bad file keeps the active triggers");
+        std::remove(path.c_str());
+    }
+}
+
+int main()
+{
+    TestOverlappingPatterns();
+    TestSharedSuffixes();
+    TestCaseFoldingAndDuplicates();
+    TestAgainstNaiveSearch();
+    TestLoadCommitAndCooldown();
+    if (failures == 0)
+    {
+        std::cout << "All chat trigger tests passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
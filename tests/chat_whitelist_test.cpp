@@ -0,0 +1,143 @@
+#include "absinthe/chat_whitelist.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+
+namespace
+{
+    int failures = 0;
+
+    void Expect(const bool condition, const std::string& what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    }
+
+    absinthe::ChatMessage MakeMessage(const unsigned char id, const std::string& name)
+    {
+        absinthe::ChatMessage message;
+        message.sender.fill(0);
+        message.sender[15] = id;
+        message.sender_name = name;
+        return message;
+    }
+
+    bool Allows(absinthe::ChatWhitelist& whitelist, const absinthe::ChatMessage& message, const std::string& command)
+    {
+        return absinthe::ChatWhitelist::Permits(whitelist.GetPermissions(message), whitelist.FindCommand(command));
+    }
+
+    bool WriteFile(const std::string& path, const std::string& contents)
+    {
+        std::ofstream file(path, std::ios::trunc);
+        file << contents;
+        return file.good();
+    }
+
+    void TestRoleMasks()
+    {
+        absinthe::ChatWhitelist whitelist;
+        const absinthe::ChatMessage alice = MakeMessage(1, "Alice");
+        const absinthe::ChatMessage mallory = MakeMessage(2, "Mallory");
+
+        Expect(whitelist.AddEntry("alice", "user"), "name entry is added");
+        Expect(!whitelist.AddEntry("ALICE", "user"), "the same role is not added twice");
+        Expect(!whitelist.AddEntry("bob", "nobody"), "an undefined role is rejected");
+        Expect(Allows(whitelist, alice, "ping") && !Allows(whitelist, alice, "search"), "user role grants only its commands");
+        Expect(whitelist.GetPermissions(mallory) == 0, "an unlisted sender has no permissions");
+
+        // The UUID entry merges with the name entry already cached for Alice.
+        Expect(whitelist.AddEntry("00000000-0000-0000-0000-000000000001", "moderator"), "uuid entry is added");
+        Expect(Allows(whitelist, alice, "search") && Allows(whitelist, alice, "ping"), "uuid and name roles are merged");
+        Expect(!Allows(whitelist, alice, "allow"), "merged roles grant nothing extra");
+
+        Expect(whitelist.RemoveEntry("00000000000000000000000000000001"), "uuid entry is removed in either spelling");
+        Expect(!Allows(whitelist, alice, "search"), "removing an entry invalidates the cached mask");
+        Expect(whitelist.RemoveEntry("Alice", "user") && whitelist.IsEmpty(), "removing the last role removes the entry");
+        Expect(whitelist.GetPermissions(alice) == 0, "a removed sender has no permissions");
+    }
+
+    void TestPermits()
+    {
+        Expect(!absinthe::ChatWhitelist::Permits(~std::uint64_t{ 0 }, std::nullopt), "a command without an id is denied");
+        Expect(absinthe::ChatWhitelist::Permits(std::uint64_t{ 1 } << 63, std::size_t{ 63 }), "the highest command bit is honoured");
+        Expect(!absinthe::ChatWhitelist::Permits(std::uint64_t{ 1 } << 62, std::size_t{ 63 }), "other bits grant nothing");
+    }
+
+    void TestCommandRegistration()
+    {
+        absinthe::ChatWhitelist whitelist;
+        const absinthe::ChatMessage admin = MakeMessage(1, "Admin");
+        const absinthe::ChatMessage user = MakeMessage(2, "User");
+        whitelist.AddEntry("admin");
+        whitelist.AddEntry("user", "user");
+
+        Expect(!Allows(whitelist, admin, "weather"), "an unknown command is denied even to admins");
+        const std::optional<std::size_t> weather = whitelist.RegisterCommand("weather");
+        Expect(weather.has_value() && whitelist.RegisterCommand("weather") == weather, "registering is idempotent");
+        Expect(Allows(whitelist, admin, "weather") && !Allows(whitelist, user, "weather"), "a registered command is covered by \"*\" only");
+
+        Expect(!whitelist.UnregisterCommand("ping"), "built-ins keep their slot");
+        Expect(whitelist.UnregisterCommand("weather") && !whitelist.FindCommand("weather"), "a plugin command is unregistered");
+        Expect(whitelist.RegisterCommand("radar") == weather, "a freed slot is reused");
+
+        std::size_t registered = 0;
+        while (whitelist.RegisterCommand("plugin" + std::to_string(registered)).has_value())
+        {
+            ++registered;
+        }
+        Expect(whitelist.FindCommand("plugin" + std::to_string(registered - 1)) == std::size_t{ 63 }, "every one of the 64 slots is used");
+    }
+
+    void TestLoadFromFile()
+    {
+        const std::string path = "absinthe_chat_whitelist_test.yaml";
+        WriteFile(path,
+            "roles:\n"
+            "  helper: [ping, weather]\n"
+            "whitelist:\n"
+            "  - player: Bob\n"
+            "    role: helper\n"
+            "  - Carol\n");
+
+        absinthe::ChatWhitelist whitelist;
+        std::string error;
+        Expect(whitelist.LoadFromFile(path, &error), "allowlist with roles loads: " + error);
+        const absinthe::ChatMessage bob = MakeMessage(1, "bob");
+        const absinthe::ChatMessage carol = MakeMessage(2, "carol");
+        Expect(Allows(whitelist, bob, "ping") && Allows(whitelist, bob, "weather"), "a custom role compiles to its commands");
+        Expect(!Allows(whitelist, bob, "echo"), "a custom role grants nothing else");
+        Expect(Allows(whitelist, carol, "allow"), "plain entries keep the default role");
+        Expect(!whitelist.UnregisterCommand("weather"), "a command a role names keeps its slot");
+
+        WriteFile(path, "roles:\n  helper: ping\nwhitelist:\n  - Dave\n");
+        Expect(!whitelist.LoadFromFile(path, &error) && error == "Whitelist role \"helper\" must be a list of commands.",
+            "a scalar role is rejected");
+        Expect(Allows(whitelist, bob, "weather") && whitelist.HasRole("helper"),
+            "a rejected file leaves the allowlist untouched");
+
+        WriteFile(path, "whitelist:\n  - player: Erin\n    role: ghost\n");
+        Expect(!whitelist.LoadFromFile(path, &error), "an entry with an undefined role is rejected");
+        std::remove(path.c_str());
+    }
+}
+
+int main()
+{
+    TestRoleMasks();
+    TestPermits();
+    TestCommandRegistration();
+    TestLoadFromFile();
+    if (failures == 0)
+    {
+        std::cout << "All chat whitelist tests passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}